@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "codec.h"
+#include "dsp.h"
+#include "engine.h"
+#include "filter_design.h"
+
+// Compares Engine::Render, which processes frames in batches source by source, against calling
+// Engine::Tick once per frame.
+//
+// A 24-source scene with a scripted stream of gain and rate changes is rendered both ways. Every
+// region must come out byte for byte identical, statuses and samples alike, before timings are
+// reported for each batch size and for the automatically tuned one.
+//
+// Batching is meant for caches that cannot hold every source's state at once, like the ARM11's
+// 16 KB L1; on a desktop they all fit and the differences are mostly noise. To keep drift from
+// favouring one side, each repetition times every variant in turn, and the median is reported.
+// AudioTest-FrameBatching measures the same on the 3DS.
+//
+//     AudioBench-FrameBatching [-r repeats]
+//   -r  renders of the scene timed per variant (default 9)
+
+using namespace DSP::HLE;
+
+namespace {
+
+using Configuration = SourceConfiguration::Configuration;
+using Format = Configuration::Format;
+using InterpolationMode = Configuration::InterpolationMode;
+
+constexpr size_t frames = 1024;
+constexpr u32 buffer_length = 32768;
+
+using Regions = std::vector<std::unique_ptr<SharedMemory>>;
+
+std::vector<u8> MakeSampleData() {
+    // Enough for the longest layout, stereo PCM16.
+    std::vector<u8> data(buffer_length * 4);
+    for (u32 i = 0; i < buffer_length * 2; i++) {
+        const double t = static_cast<double>(i / 2);
+        const s16 sample = static_cast<s16>((std::sin(t * 0.021) * 0.6 + std::sin(t * 0.43) * 0.2) * 32767.0);
+        std::memcpy(&data[i * 2], &sample, 2);
+    }
+    return data;
+}
+
+void ConfigureScene(SharedMemory& region) {
+    for (size_t i = 0; i < AudioCore::num_sources; i++) {
+        Configuration& config = region.source_configurations.config[i];
+        const Format format = static_cast<Format>(i % 3);
+
+        config.gain[i % 3][0] = 0.05f;
+        config.gain[i % 3][1] = 0.05f;
+        config.gain_0_dirty.Assign(1);
+        config.gain_1_dirty.Assign(1);
+        config.gain_2_dirty.Assign(1);
+        config.rate_multiplier = 0.6f + 0.07f * static_cast<float>(i);
+        config.rate_multiplier_dirty.Assign(1);
+        config.interpolation_mode = static_cast<InterpolationMode>(i / 3 % 3);
+        config.interpolation_dirty.Assign(1);
+        config.simple_filter = FilterDesign::Quantize(FilterDesign::OnePoleLowPass(6000.0));
+        config.simple_filter_dirty.Assign(1);
+        config.biquad_filter = FilterDesign::Quantize(FilterDesign::LowPass(2000.0 + 300.0 * static_cast<double>(i), 0.7071));
+        config.biquad_filter_dirty.Assign(1);
+        config.filters_enabled = static_cast<u16>(i % 4);
+        config.filters_enabled_dirty.Assign(1);
+        config.adpcm_coefficients_dirty.Assign(1);
+
+        config.format.Assign(format);
+        config.mono_or_stereo.Assign(i % 2 && format != Format::ADPCM ? Configuration::MonoOrStereo::Stereo : Configuration::MonoOrStereo::Mono);
+        config.physical_address = 0;
+        config.length = buffer_length;
+        config.buffer_id = 1;
+        config.is_looping.Assign(1);
+        config.embedded_buffer_dirty.Assign(1);
+        config.enable = 1;
+        config.enable_dirty.Assign(1);
+
+        for (size_t c = 0; c < 8; c++) {
+            region.adpcm_coefficients.coeff[i][c * 2 + 0] = static_cast<s16>(1024 + 256 * c);
+            region.adpcm_coefficients.coeff[i][c * 2 + 1] = static_cast<s16>(-512 - 64 * c);
+        }
+    }
+
+    for (size_t mix = 0; mix < 3; mix++) {
+        region.dsp_configuration.volume[mix] = 1.0f;
+    }
+    region.dsp_configuration.volume_0_dirty.Assign(1);
+    region.dsp_configuration.volume_1_dirty.Assign(1);
+    region.dsp_configuration.volume_2_dirty.Assign(1);
+}
+
+/// One region per frame: the scene setup in the first, then a gain or rate change every few frames.
+Regions MakeRegions() {
+    Regions regions(frames);
+    for (size_t frame = 0; frame < frames; frame++) {
+        regions[frame] = std::make_unique<SharedMemory>();
+        SharedMemory& region = *regions[frame];
+        std::memset(static_cast<void*>(&region), 0, sizeof(SharedMemory));
+        region.frame_counter = static_cast<u16>(frame);
+
+        if (frame == 0) {
+            ConfigureScene(region);
+            continue;
+        }
+
+        Configuration& config = region.source_configurations.config[frame * 7 % AudioCore::num_sources];
+        if (frame % 5 == 0) {
+            const float gain = 0.02f * static_cast<float>(frame % 4);
+            config.gain[0][0] = gain;
+            config.gain[0][1] = gain;
+            config.gain_0_dirty.Assign(1);
+        } else if (frame % 3 == 0) {
+            config.rate_multiplier = 0.5f + 0.01f * static_cast<float>(frame % 150);
+            config.rate_multiplier_dirty.Assign(1);
+        }
+    }
+    return regions;
+}
+
+std::vector<SharedMemory*> Pointers(const Regions& regions) {
+    std::vector<SharedMemory*> ret;
+    for (const auto& region : regions)
+        ret.push_back(region.get());
+    return ret;
+}
+
+bool Identical(const Regions& a, const Regions& b) {
+    for (size_t frame = 0; frame < frames; frame++) {
+        if (std::memcmp(a[frame].get(), b[frame].get(), sizeof(SharedMemory)) != 0)
+            return false;
+    }
+    return true;
+}
+
+/// A way of rendering the scene: Tick per frame, or Render with a batch size (0 tunes it).
+struct Variant {
+    bool batched;
+    size_t batch;
+    std::vector<double> ns_per_frame;
+    size_t chosen = 0;
+};
+
+/// Renders the scene on a fresh engine into `regions` and returns the time per frame.
+double Render(const MemoryTranslator& memory, Variant& variant, Regions& regions) {
+    const auto engine = std::make_unique<Engine>(memory);
+    const std::vector<SharedMemory*> pointers = Pointers(regions);
+    const auto start = std::chrono::steady_clock::now();
+    if (variant.batched) {
+        engine->SetBatchFrames(variant.batch);
+        engine->Render(pointers.data(), pointers.size());
+    } else {
+        for (SharedMemory* region : pointers)
+            engine->Tick(*region);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    variant.chosen = engine->BatchFrames();
+    return std::chrono::duration<double, std::nano>(end - start).count() / frames;
+}
+
+double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    size_t repeats = 9;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            repeats = std::max(1, std::atoi(argv[++i]));
+    }
+
+    const std::vector<u8> data = MakeSampleData();
+    const MemoryTranslator memory = [&data](PAddr, u32 size) -> const u8* {
+        return size <= data.size() ? data.data() : nullptr;
+    };
+
+    std::vector<Variant> variants{{false, 1, {}}};
+    for (size_t batch : {size_t{2}, size_t{4}, Engine::max_batch_frames, size_t{0}})
+        variants.push_back({true, batch, {}});
+
+    Regions expected = MakeRegions();
+    Render(memory, variants[0], expected);
+
+    bool all_match = true;
+    std::vector<bool> match(variants.size(), true);
+    for (size_t i = 0; i < repeats; i++) {
+        for (size_t v = 0; v < variants.size(); v++) {
+            Regions regions = MakeRegions();
+            variants[v].ns_per_frame.push_back(Render(memory, variants[v], regions));
+            if (i == 0) {
+                match[v] = Identical(expected, regions);
+                all_match = all_match && match[v];
+            }
+        }
+    }
+
+    const double t_tick = Median(variants[0].ns_per_frame);
+    printf("%zu frames, median of %zu renders\n\n", frames, repeats);
+    printf("%-10s %10s %10s %8s\n", "batch", "per frame", "fastest", "speedup");
+    for (size_t v = 0; v < variants.size(); v++) {
+        const Variant& variant = variants[v];
+        char name[32];
+        if (!variant.batched)
+            snprintf(name, sizeof(name), "tick");
+        else if (variant.batch == 0)
+            snprintf(name, sizeof(name), "auto (%zu)", variant.chosen);
+        else
+            snprintf(name, sizeof(name), "%zu", variant.batch);
+        const double t = Median(variant.ns_per_frame);
+        const double fastest = *std::min_element(variant.ns_per_frame.begin(), variant.ns_per_frame.end());
+        printf("%-10s %8.0fns %8.0fns %7.2fx%s\n", name, t, fastest, t_tick / t, match[v] ? "" : "  MISMATCH");
+    }
+
+    printf("\noutputs %s\n", all_match ? "match" : "DIFFER");
+    return all_match ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include "stress_scene.h"
+
+// Worst-case time of a frame with every source playing: the full-polyphony stress scene (all 24
+// sources, every format and interpolation mode, both filters, all three mixers, both delay
+// effects) rendered frame by frame with Engine::Tick.
+//
+// The worst frame is what has to fit in the DSP's frame period, so it is reported against that
+// budget alongside the mean, median and 99th percentile, followed by the slowest frames. On a
+// desktop the worst frame is often one the OS interrupted; if it stands far above p99, run again.
+// The same scene runs on the 3DS in AudioTest-FullPolyphony.
+//
+//     AudioBench-FullPolyphony [-n frames] [-p]
+//   -n  frames to render (default 2000)
+//   -p  uses the float preview pipelines instead of the bit-exact ones, and afterwards reports their
+//       deviation from the bit-exact output with the engine's error meter (untimed). The run fails
+//       if there is none, or if it is well beyond what Precision::Preview documents.
+
+using namespace DSP::HLE;
+
+namespace {
+
+constexpr size_t slowest_shown = 5;
+
+/// Limits on the preview's deviation, about twice what Precision::Preview documents for this scene
+/// (max 14, RMS 2.5, mean within 0.1 over long runs but up to 1.6 over a frame or two).
+constexpr s32 preview_max_limit = 32;
+constexpr double preview_rms_limit = 5.0;
+constexpr double preview_mean_limit = 3.0;
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    size_t frames = 2000;
+    Precision precision = Precision::BitExact;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            frames = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "-p") == 0)
+            precision = Precision::Preview;
+    }
+
+    const StressScene::Measurement measurement = StressScene::Measure(frames, precision);
+    const StressScene::Summary summary = StressScene::Summarize(measurement);
+    if (measurement.min_active_sources != AudioCore::num_sources) {
+        std::fprintf(stderr, "only %zu of %zu sources kept playing\n", measurement.min_active_sources,
+                     AudioCore::num_sources);
+        return 1;
+    }
+
+    const double budget = StressScene::frame_budget_us;
+    std::printf("%zu sources, %zu frames, %s\n\n", AudioCore::num_sources, frames,
+                precision == Precision::BitExact ? "bit-exact" : "preview");
+    std::printf("%-8s %10s %8s\n", "", "us", "budget");
+    const auto row = [&](const char* name, double value) {
+        std::printf("%-8s %10.2f %7.1f%%\n", name, value, 100.0 * value / budget);
+    };
+    row("mean", summary.mean);
+    row("median", summary.median);
+    row("p99", summary.p99);
+    row("worst", summary.max);
+    std::printf("\nbudget %.2f us per frame\n", budget);
+
+    std::vector<size_t> order(measurement.frame_us.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    const size_t shown = std::min(slowest_shown, order.size());
+    std::partial_sort(order.begin(), order.begin() + shown, order.end(),
+                      [&](size_t a, size_t b) { return measurement.frame_us[a] > measurement.frame_us[b]; });
+    std::printf("slowest frames:");
+    for (size_t i = 0; i < shown; i++)
+        std::printf(" %zu (%.2f us)", order[i], measurement.frame_us[order[i]]);
+    std::printf("\n");
+
+    if (precision == Precision::Preview) {
+        // Preview is not bit-exact on this scene, so a meter that measures nothing is broken.
+        // Deviation beyond the limits means the preview pipelines are.
+        const ErrorStats error = StressScene::MeasurePreviewError(frames);
+        std::printf("\npreview deviation over %llu samples: max %d, mean %.3f, rms %.3f\n",
+                    static_cast<unsigned long long>(error.samples), error.max_deviation, error.MeanDeviation(),
+                    error.RmsDeviation());
+        if (error.max_deviation == 0 || error.RmsDeviation() == 0.0) {
+            std::fprintf(stderr, "error meter measured no deviation\n");
+            return 1;
+        }
+        if (error.max_deviation >= preview_max_limit || error.RmsDeviation() >= preview_rms_limit ||
+            std::abs(error.MeanDeviation()) >= preview_mean_limit) {
+            std::fprintf(stderr, "preview deviates beyond max %d, rms %.1f, mean %.1f\n", preview_max_limit,
+                         preview_rms_limit, preview_mean_limit);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "dsp.h"
+#include "hle_common.h"
+#include "interpolate.h"
+#include "source.h"
+
+// Characterizes the resamplers: quality and cost of every interpolation mode and polyphase
+// coefficient set across the rate_multiplier range.
+//
+// Each sweep point plays sine tones through a Source and analyses its output with a windowed FFT:
+//   SNR      a tone at 0.1 cycles per input sample (lower at high rates, so its output stays below
+//            Nyquist) against everything but its harmonics and DC.
+//   THD      harmonics 2 to 5 of the same tone against the tone.
+//   aliasing a tone at 0.4 cycles per input sample: all output except the tone itself (if it is
+//            below output Nyquist) and DC, relative to the input tone. Includes images when
+//            upsampling and aliases when downsampling.
+// Throughput is output samples per second of Source::GenerateFrame at that point. Points run in
+// parallel, so throughput is per core with every core busy; use -t 1 for unloaded numbers.
+//
+//     AudioBench-ResamplerSweep [-t threads] [-p] [-c]
+//   -p  sweeps the float preview pipelines instead of the bit-exact ones
+//   -c  prints CSV instead of a table
+
+using namespace DSP::HLE;
+
+using Configuration = SourceConfiguration::Configuration;
+using InterpolationMode = Configuration::InterpolationMode;
+
+namespace {
+
+constexpr double pi = 3.14159265358979323846;
+
+constexpr size_t fft_size = 8192;
+constexpr size_t warmup_frames = 4;
+constexpr size_t analysed_frames = (fft_size + AudioCore::samples_per_frame - 1) / AudioCore::samples_per_frame;
+constexpr size_t timed_frames = 4000;
+
+/// Bins either side of a tone that belong to it: the Blackman-Harris main lobe is four bins wide.
+constexpr size_t lobe_bins = 6;
+
+constexpr double amplitude = 16384.0;
+constexpr double low_tone = 0.1;
+constexpr double high_tone = 0.4;
+
+/// The rates the hardware tests use, plus the range up to the modelled maximum.
+constexpr float rates[] = {0.025f, 0.05f, 0.1f, 0.1237f, 31.f / 127.f, 0.4f, 0.5f, 0.75f, 1.0f,
+                           1.5f,   2.0f,  3.0f, 4.0f,    8.0f,         16.0f};
+
+struct Mode {
+    const char* name;
+    InterpolationMode mode;
+    u8 coefficient_set;
+};
+
+constexpr Mode modes[] = {
+    {"none", InterpolationMode::None, 0},           {"linear", InterpolationMode::Linear, 0},
+    {"polyphase 0", InterpolationMode::Polyphase, 0}, {"polyphase 1", InterpolationMode::Polyphase, 1},
+    {"polyphase 2", InterpolationMode::Polyphase, 2}, {"polyphase 3", InterpolationMode::Polyphase, 3},
+};
+
+struct Point {
+    const Mode* mode;
+    float rate;
+
+    double snr_db;
+    double thd_db;
+    double aliasing_db;
+    double samples_per_second;
+};
+
+/// Folds a frequency in cycles per sample into [0, 0.5].
+double Fold(double frequency) {
+    frequency -= std::floor(frequency);
+    return frequency > 0.5 ? 1.0 - frequency : frequency;
+}
+
+void FFT(std::vector<std::complex<double>>& x) {
+    const size_t n = x.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(x[i], x[j]);
+    }
+    for (size_t length = 2; length <= n; length <<= 1) {
+        const std::complex<double> step = std::polar(1.0, -2.0 * pi / static_cast<double>(length));
+        for (size_t start = 0; start < n; start += length) {
+            std::complex<double> w = 1.0;
+            for (size_t k = 0; k < length / 2; k++, w *= step) {
+                const std::complex<double> even = x[start + k];
+                const std::complex<double> odd = x[start + k + length / 2] * w;
+                x[start + k] = even + odd;
+                x[start + k + length / 2] = even - odd;
+            }
+        }
+    }
+}
+
+/// Four-term Blackman-Harris: sidelobes at -92 dB, below the 16-bit noise floor of the tones.
+const std::vector<double> window = [] {
+    std::vector<double> w(fft_size);
+    for (size_t i = 0; i < fft_size; i++) {
+        const double x = 2.0 * pi * static_cast<double>(i) / static_cast<double>(fft_size);
+        w[i] = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2.0 * x) - 0.01168 * std::cos(3.0 * x);
+    }
+    return w;
+}();
+
+/// One-sided power spectrum of the windowed signal.
+std::vector<double> PowerSpectrum(const std::vector<double>& signal) {
+    std::vector<std::complex<double>> x(fft_size);
+    for (size_t i = 0; i < fft_size; i++)
+        x[i] = signal[i] * window[i];
+    FFT(x);
+    std::vector<double> power(fft_size / 2 + 1);
+    for (size_t k = 0; k < power.size(); k++)
+        power[k] = std::norm(x[k]);
+    return power;
+}
+
+/// Power of the input tone as the analysis sees it, the reference for the aliasing figure.
+const double reference_power = [] {
+    std::vector<double> tone(fft_size);
+    for (size_t i = 0; i < fft_size; i++)
+        tone[i] = amplitude * std::sin(2.0 * pi * 0.125 * static_cast<double>(i));
+    double total = 0.0;
+    for (double p : PowerSpectrum(tone))
+        total += p;
+    return total;
+}();
+
+/// Sums the power within the main lobe around `frequency`, and marks those bins as used.
+double TakeLobe(const std::vector<double>& power, std::vector<bool>& used, double frequency) {
+    const size_t centre = static_cast<size_t>(std::lround(Fold(frequency) * fft_size));
+    double sum = 0.0;
+    for (size_t k = centre > lobe_bins ? centre - lobe_bins : 0; k <= std::min(centre + lobe_bins, power.size() - 1); k++) {
+        if (!used[k])
+            sum += power[k];
+        used[k] = true;
+    }
+    return sum;
+}
+
+double Decibels(double ratio) {
+    return 10.0 * std::log10(std::max(ratio, 1e-30));
+}
+
+/// Drives one Source through a mono PCM16 buffer.
+class Player {
+public:
+    Player(const Mode& mode, float rate, bool preview, std::vector<s16> input_, bool looping) : input(std::move(input_)) {
+        const u8* const data = reinterpret_cast<const u8*>(input.data());
+        memory = [data](PAddr, u32) { return data; };
+
+        // A source with no gain is skipped, so route it to the first mixer.
+        Configuration config{};
+        config.gain[0][0] = 1.0f;
+        config.gain_0_dirty.Assign(1);
+        config.rate_multiplier = rate;
+        config.interpolation_mode = mode.mode;
+        config.interpolation_related = mode.coefficient_set;
+        config.format.Assign(Configuration::Format::PCM16);
+        config.mono_or_stereo.Assign(Configuration::MonoOrStereo::Mono);
+        config.physical_address = 0;
+        config.length = static_cast<u32>(input.size());
+        config.is_looping.Assign(looping);
+        config.buffer_id = 1;
+        config.enable = 1;
+        config.rate_multiplier_dirty.Assign(1);
+        config.interpolation_dirty.Assign(1);
+        config.enable_dirty.Assign(1);
+        config.embedded_buffer_dirty.Assign(1);
+
+        source->SetPrecision(preview ? Precision::Preview : Precision::BitExact);
+        source->ParseConfig(config, coeffs);
+    }
+
+    const StereoFrame16& Frame() {
+        source->GenerateFrame(memory, staging, frame);
+        return frame;
+    }
+
+private:
+    std::vector<s16> input;
+    std::unique_ptr<Source> source = std::make_unique<Source>();
+    MemoryTranslator memory;
+    s16_le coeffs[16]{};
+    AudioInterp::StagingBuffer staging;
+    alignas(16) StereoFrame16 frame;
+};
+
+std::vector<s16> Tone(double frequency, size_t length) {
+    std::vector<s16> tone(length);
+    for (size_t i = 0; i < length; i++)
+        tone[i] = static_cast<s16>(std::lround(amplitude * std::sin(2.0 * pi * frequency * static_cast<double>(i))));
+    return tone;
+}
+
+/// Plays a tone at `frequency` cycles per input sample and returns the analysed stretch of output.
+std::vector<double> Render(const Point& point, bool preview, double frequency) {
+    const size_t output = (warmup_frames + analysed_frames) * AudioCore::samples_per_frame;
+    const size_t length = static_cast<size_t>(std::ceil(output * static_cast<double>(point.rate))) + 2 * AudioCore::samples_per_frame;
+    Player player(*point.mode, point.rate, preview, Tone(frequency, length), false);
+
+    std::vector<double> signal;
+    for (size_t frame = 0; frame < warmup_frames + analysed_frames; frame++) {
+        const StereoFrame16& out = player.Frame();
+        if (frame >= warmup_frames)
+            signal.insert(signal.end(), out[0].begin(), out[0].end());
+    }
+    signal.resize(fft_size);
+    return signal;
+}
+
+void Measure(Point& point, bool preview) {
+    const double rate = point.rate;
+
+    // Tone and distortion.
+    {
+        const double tone = std::min(low_tone, 0.2 / rate);
+        const std::vector<double> power = PowerSpectrum(Render(point, preview, tone));
+        std::vector<bool> used(power.size(), false);
+        const double dc = TakeLobe(power, used, 0.0);
+        const double fundamental = TakeLobe(power, used, tone * rate);
+        double harmonics = 0.0;
+        for (int h = 2; h <= 5; h++)
+            harmonics += TakeLobe(power, used, h * tone * rate);
+        double total = 0.0;
+        for (double p : power)
+            total += p;
+        const double noise = total - dc - fundamental - harmonics;
+        point.snr_db = Decibels(fundamental / noise);
+        point.thd_db = Decibels(harmonics / fundamental);
+    }
+
+    // Aliasing and imaging.
+    {
+        const std::vector<double> power = PowerSpectrum(Render(point, preview, high_tone));
+        std::vector<bool> used(power.size(), false);
+        const double dc = TakeLobe(power, used, 0.0);
+        const double wanted = high_tone * rate < 0.5 ? TakeLobe(power, used, high_tone * rate) : 0.0;
+        double total = 0.0;
+        for (double p : power)
+            total += p;
+        point.aliasing_db = Decibels((total - dc - wanted) / reference_power);
+    }
+
+    // Throughput, on a looping buffer so that any number of frames can be timed.
+    {
+        Player player(*point.mode, point.rate, preview, Tone(low_tone, 1 << 16), true);
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t frame = 0; frame < timed_frames; frame++)
+            player.Frame();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        point.samples_per_second = static_cast<double>(timed_frames * AudioCore::samples_per_frame) / seconds;
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool preview = false;
+    bool csv = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "-p") == 0)
+            preview = true;
+        else if (std::strcmp(argv[i], "-c") == 0)
+            csv = true;
+    }
+
+    std::vector<Point> points;
+    for (const Mode& mode : modes) {
+        for (float rate : rates)
+            points.push_back(Point{&mode, rate, 0.0, 0.0, 0.0, 0.0});
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            for (size_t i; (i = next.fetch_add(1)) < points.size();)
+                Measure(points[i], preview);
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (csv) {
+        printf("mode,coefficient_set,rate_multiplier,snr_db,thd_db,aliasing_db,samples_per_second\n");
+        for (const Point& p : points) {
+            printf("%s,%u,%f,%.2f,%.2f,%.2f,%.0f\n", p.mode->mode == InterpolationMode::Polyphase ? "polyphase" : p.mode->name,
+                   p.mode->coefficient_set, p.rate, p.snr_db, p.thd_db, p.aliasing_db, p.samples_per_second);
+        }
+        return 0;
+    }
+
+    printf("%s pipelines, %zu points on %u threads in %.1fs\n\n", preview ? "preview" : "bit-exact", points.size(), threads, seconds);
+    printf("%-12s %9s %8s %8s %9s %10s\n", "mode", "rate", "SNR dB", "THD dB", "alias dB", "Msamples/s");
+    const Mode* previous = nullptr;
+    for (const Point& p : points) {
+        if (previous && previous != p.mode)
+            printf("\n");
+        previous = p.mode;
+        printf("%-12s %9.6f %8.1f %8.1f %9.1f %10.2f\n", p.mode->name, p.rate, p.snr_db, p.thd_db, p.aliasing_db,
+               p.samples_per_second / 1e6);
+    }
+    return 0;
+}
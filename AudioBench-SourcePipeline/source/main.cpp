@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "codec.h"
+#include "dsp.h"
+#include "fixed_point.h"
+#include "hle_common.h"
+#include "interpolate.h"
+#include "source.h"
+
+// Compares the specialized source pipelines against a loop that checks every mode per sample.
+//
+// Both play the same looping buffer into a StereoFrame16, the output of Source::GenerateFrame, and
+// must produce identical output, which is checked before timing. Both are timed doing the same
+// work, with the input decoded a frame at a time. Polyphase is left out because its kernels are
+// internal to the engine; the reference covers None and Linear with every format, channel layout
+// and filter combination.
+
+using namespace DSP::HLE;
+
+using Configuration = SourceConfiguration::Configuration;
+using Format = Configuration::Format;
+using InterpolationMode = Configuration::InterpolationMode;
+
+constexpr u32 buffer_length = 4096;
+constexpr float rate_multiplier = 1.37f;
+constexpr size_t check_frames = 64;
+constexpr size_t timed_frames = 20000;
+
+constexpr Configuration::SimpleFilter simple_filter{0x3000, 0x2000};
+constexpr Configuration::BiquadFilter biquad_filter{-0x0E00, 0x5800, 0x0400, 0x0800, 0x0400};
+
+struct Settings {
+    Format format;
+    unsigned channels;
+    InterpolationMode mode;
+    bool simple_on;
+    bool biquad_on;
+};
+
+struct TestData {
+    std::vector<u8> pcm8;
+    std::vector<u8> pcm16;
+    std::vector<u8> adpcm;
+    std::array<s16, 16> coeffs;
+
+    const std::vector<u8>& For(Format format) const {
+        switch (format) {
+        case Format::PCM8:
+            return pcm8;
+        case Format::PCM16:
+            return pcm16;
+        default:
+            return adpcm;
+        }
+    }
+};
+
+TestData MakeTestData() {
+    TestData data;
+    data.pcm8.resize(buffer_length * 2);
+    data.pcm16.resize(buffer_length * 4);
+    data.adpcm.resize(Codec::BytesForSamples(Format::ADPCM, 1, buffer_length));
+
+    for (u32 i = 0; i < buffer_length * 2; i++) {
+        const double t = static_cast<double>(i / 2);
+        const double x = std::sin(t * (i % 2 ? 0.031 : 0.047)) * 0.8 + std::sin(t * 0.9) * 0.15;
+        const s16 sample = static_cast<s16>(x * 32767.0);
+        data.pcm8[i] = static_cast<u8>(sample >> 8);
+        std::memcpy(&data.pcm16[i * 2], &sample, 2);
+    }
+
+    u32 seed = 12345;
+    for (size_t i = 0; i < data.adpcm.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        data.adpcm[i] = static_cast<u8>(seed >> 16);
+        if (i % Codec::adpcm_frame_bytes == 0)
+            data.adpcm[i] = static_cast<u8>((data.adpcm[i] & 0x70) | (data.adpcm[i] % 10));
+    }
+    for (size_t i = 0; i < 8; i++) {
+        data.coeffs[i * 2 + 0] = static_cast<s16>(1024 + 256 * i);
+        data.coeffs[i * 2 + 1] = static_cast<s16>(-512 - 64 * i);
+    }
+
+    return data;
+}
+
+/**
+ * Plays one looping buffer, deciding format, channel layout, interpolation and filters per sample.
+ * The work per frame is the engine's: the frame's input is decoded in one pass behind four samples
+ * of history, then resampled and filtered into the output.
+ */
+class BranchingSource {
+public:
+    BranchingSource(const Settings& settings_, const TestData& data_)
+        : settings(settings_), data(data_), input(data_.For(settings_.format).data()),
+          rate(AudioInterp::RateToFixed(rate_multiplier)) {}
+
+    void Frame(StereoFrame16& out) {
+        const u32 needed = AudioInterp::InputSamplesNeeded(fraction, rate);
+        Decode(needed);
+
+        u32 position = fraction;
+        for (size_t i = 0; i < AudioCore::samples_per_frame; i++, position += rate) {
+            // The engine reads two samples behind the resampling position.
+            const size_t index = (position >> 16) + 2;
+            const s32 f0 = static_cast<s32>(position & 0xFFFF);
+
+            for (unsigned ch = 0; ch < 2; ch++) {
+                // Mono sources are filtered once and then duplicated.
+                if (ch == 1 && (settings.channels == 1 || settings.format == Format::ADPCM)) {
+                    out[1][i] = out[0][i];
+                    break;
+                }
+
+                const s32 x0 = staging[ch][index];
+                s32 y;
+                switch (settings.mode) {
+                case InterpolationMode::None:
+                    y = x0;
+                    break;
+                case InterpolationMode::Linear:
+                default:
+                    y = x0 + ((f0 * SaturateS16(staging[ch][index + 1] - x0)) >> 16);
+                    break;
+                }
+
+                if (settings.biquad_on) {
+                    const s64 acc = static_cast<s64>(biquad_filter.b0) * y + static_cast<s64>(biquad_filter.b1) * bx1[ch] +
+                                    static_cast<s64>(biquad_filter.b2) * bx2[ch] + static_cast<s64>(biquad_filter.a1) * by1[ch] +
+                                    static_cast<s64>(biquad_filter.a2) * by2[ch];
+                    bx2[ch] = bx1[ch];
+                    bx1[ch] = y;
+                    y = static_cast<s32>(std::clamp<s64>(acc >> 14, -32768, 32767));
+                    by2[ch] = by1[ch];
+                    by1[ch] = y;
+                }
+                if (settings.simple_on) {
+                    y = SaturateS16((y * simple_filter.b0 + simple_filter.a1 * sy1[ch]) >> 15);
+                    sy1[ch] = y;
+                }
+
+                out[ch][i] = static_cast<s16>(y);
+            }
+        }
+
+        for (auto& channel : staging)
+            std::copy_n(channel.begin() + needed, AudioInterp::history_size, channel.begin());
+        fraction = (fraction + rate * static_cast<u32>(AudioCore::samples_per_frame)) & 0xFFFF;
+    }
+
+private:
+    /// Decodes the next `count` samples of the looping buffer behind the history, in runs that end
+    /// where the buffer wraps.
+    void Decode(u32 count) {
+        for (u32 written = 0; written < count;) {
+            const u32 run = std::min(count - written, buffer_length - read_position);
+            s16* const left = &staging[0][AudioInterp::history_size + written];
+            s16* const right = &staging[1][AudioInterp::history_size + written];
+            if (settings.format == Format::ADPCM) {
+                // The looping buffer reloads its (zero) history at the start of every playthrough.
+                if (read_position == 0)
+                    adpcm_state = {};
+                Codec::DecodeADPCM(input, read_position, run, data.coeffs, adpcm_state, left);
+            } else {
+                for (u32 k = 0; k < run; k++) {
+                    const u32 n = read_position + k;
+                    for (unsigned ch = 0; ch < settings.channels; ch++) {
+                        s16& sample = (ch == 0 ? left : right)[k];
+                        if (settings.format == Format::PCM8)
+                            sample = static_cast<s16>(static_cast<s8>(input[n * settings.channels + ch]) * 256);
+                        else
+                            std::memcpy(&sample, &input[(n * settings.channels + ch) * 2], 2);
+                    }
+                }
+            }
+            written += run;
+            read_position = (read_position + run) % buffer_length;
+        }
+    }
+
+    Settings settings;
+    const TestData& data;
+    const u8* input;
+    u32 rate;
+    u32 fraction = 0;
+
+    u32 read_position = 0;
+    AudioInterp::StagingBuffer staging{};
+    Codec::AdpcmState adpcm_state;
+
+    std::array<s32, 2> sy1{}, bx1{}, bx2{}, by1{}, by2{};
+};
+
+/// Wraps an engine Source set up to play the same looping buffer.
+class SpecializedSource {
+public:
+    SpecializedSource(const Settings& settings, const TestData& data) {
+        const u8* const input = data.For(settings.format).data();
+        memory = [input](PAddr, u32) { return input; };
+        std::copy(data.coeffs.begin(), data.coeffs.end(), coeffs);
+
+        Configuration config{};
+        config.gain[0][0] = 1.0f;
+        config.gain[0][1] = 1.0f;
+        config.rate_multiplier = rate_multiplier;
+        config.interpolation_mode = settings.mode;
+        config.simple_filter = simple_filter;
+        config.biquad_filter = biquad_filter;
+        config.simple_filter_enabled.Assign(settings.simple_on);
+        config.biquad_filter_enabled.Assign(settings.biquad_on);
+        config.format.Assign(settings.format);
+        config.mono_or_stereo.Assign(settings.channels == 2 ? Configuration::MonoOrStereo::Stereo : Configuration::MonoOrStereo::Mono);
+        config.physical_address = 0;
+        config.length = buffer_length;
+        config.adpcm_dirty.Assign(1);
+        config.is_looping.Assign(1);
+        config.buffer_id = 1;
+        config.enable = 1;
+        config.gain_0_dirty.Assign(1);
+        config.rate_multiplier_dirty.Assign(1);
+        config.interpolation_dirty.Assign(1);
+        config.filters_enabled_dirty.Assign(1);
+        config.simple_filter_dirty.Assign(1);
+        config.biquad_filter_dirty.Assign(1);
+        config.adpcm_coefficients_dirty.Assign(1);
+        config.enable_dirty.Assign(1);
+        config.embedded_buffer_dirty.Assign(1);
+
+        source.ParseConfig(config, coeffs);
+    }
+
+    void Frame(StereoFrame16& out) {
+        source.GenerateFrame(memory, staging, out);
+    }
+
+private:
+    Source source;
+    MemoryTranslator memory;
+    s16_le coeffs[16];
+    AudioInterp::StagingBuffer staging;
+};
+
+template <typename F>
+double NanosecondsPerFrame(F&& frame) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < timed_frames; i++)
+        frame();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / timed_frames;
+}
+
+const char* FormatName(Format format) {
+    switch (format) {
+    case Format::PCM8:
+        return "PCM8";
+    case Format::PCM16:
+        return "PCM16";
+    default:
+        return "ADPCM";
+    }
+}
+
+int main() {
+    const TestData data = MakeTestData();
+
+    printf("%-6s %-6s %-7s %-13s %12s %12s %8s\n", "format", "chans", "interp", "filters", "branching", "specialized", "speedup");
+
+    bool all_match = true;
+    double total_branching = 0.0, total_specialized = 0.0;
+
+    for (Format format : {Format::PCM8, Format::PCM16, Format::ADPCM}) {
+        for (unsigned channels : {1u, 2u}) {
+            if (format == Format::ADPCM && channels == 2)
+                continue;
+            for (InterpolationMode mode : {InterpolationMode::None, InterpolationMode::Linear}) {
+                for (unsigned filters = 0; filters < 4; filters++) {
+                    const Settings settings{format, channels, mode, (filters & 1) != 0, (filters & 2) != 0};
+
+                    bool match = true;
+                    {
+                        auto branching = std::make_unique<BranchingSource>(settings, data);
+                        auto specialized = std::make_unique<SpecializedSource>(settings, data);
+                        alignas(16) StereoFrame16 expected, actual;
+                        for (size_t i = 0; i < check_frames && match; i++) {
+                            branching->Frame(expected);
+                            specialized->Frame(actual);
+                            match = expected == actual;
+                        }
+                    }
+                    all_match &= match;
+
+                    auto branching = std::make_unique<BranchingSource>(settings, data);
+                    auto specialized = std::make_unique<SpecializedSource>(settings, data);
+                    alignas(16) StereoFrame16 out;
+                    const double t_branching = NanosecondsPerFrame([&] { branching->Frame(out); });
+                    const double t_specialized = NanosecondsPerFrame([&] { specialized->Frame(out); });
+                    total_branching += t_branching;
+                    total_specialized += t_specialized;
+
+                    static const char* const filter_names[] = {"none", "simple", "biquad", "simple+biquad"};
+                    printf("%-6s %-6u %-7s %-13s %10.0fns %10.0fns %7.2fx%s\n", FormatName(format), channels,
+                           mode == InterpolationMode::None ? "none" : "linear", filter_names[filters],
+                           t_branching, t_specialized, t_branching / t_specialized, match ? "" : "  MISMATCH");
+                }
+            }
+        }
+    }
+
+    printf("\ntotal: branching %.0fns, specialized %.0fns, speedup %.2fx\n", total_branching, total_specialized, total_branching / total_specialized);
+    printf("outputs %s\n", all_match ? "match" : "DIFFER");
+    return all_match ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "dsp.h"
+#include "engine.h"
+#include "filter_design.h"
+#include "profiler.h"
+
+// Breaks the cost of each frame down by pipeline stage, using the engine's profiling scopes.
+//
+// A busy 24-source scene (all formats and interpolation modes, both filters, a delay effect on each
+// auxiliary mix) is rendered frame by frame. The engine is built with DSP_PROFILE, so every stage
+// is timed; the table gives each stage's time per frame (mean, median and 99th percentile over the
+// frames recorded), and -o writes the events as trace-event JSON for chrome://tracing or
+// https://ui.perfetto.dev.
+//
+// "other" is the part of each frame outside every stage: source selection, the intermediate mix
+// copies and the profiling scopes themselves.
+//
+//     AudioBench-StageProfile [-n frames] [-o trace.json]
+//   -n  frames to render (default 200; the trace keeps about that many)
+
+using namespace DSP::HLE;
+
+using Configuration = SourceConfiguration::Configuration;
+using Format = Configuration::Format;
+using InterpolationMode = Configuration::InterpolationMode;
+using Profiler::Stage;
+
+namespace {
+
+constexpr u32 buffer_length = 32768;
+
+/// Stages that do not contain one another, so their times add up to the frame.
+constexpr Stage leaf_stages[] = {Stage::Queue, Stage::Decode, Stage::Interpolate, Stage::Filter,
+                                 Stage::Mix,   Stage::Effects, Stage::FinalMix};
+
+constexpr size_t num_stages = static_cast<size_t>(Stage::Count);
+
+std::vector<u8> MakeSampleData() {
+    // Enough for the longest layout, stereo PCM16.
+    std::vector<u8> data(buffer_length * 4);
+    for (u32 i = 0; i < buffer_length * 2; i++) {
+        const double t = static_cast<double>(i / 2);
+        const s16 sample = static_cast<s16>((std::sin(t * 0.021) * 0.6 + std::sin(t * 0.43) * 0.2) * 32767.0);
+        std::memcpy(&data[i * 2], &sample, 2);
+    }
+    return data;
+}
+
+void ConfigureScene(SharedMemory& region) {
+    for (size_t i = 0; i < AudioCore::num_sources; i++) {
+        Configuration& config = region.source_configurations.config[i];
+        const Format format = static_cast<Format>(i % 3);
+
+        config.gain[i % 3][0] = 0.05f;
+        config.gain[i % 3][1] = 0.05f;
+        config.gain_0_dirty.Assign(1);
+        config.gain_1_dirty.Assign(1);
+        config.gain_2_dirty.Assign(1);
+        config.rate_multiplier = 0.6f + 0.07f * static_cast<float>(i);
+        config.rate_multiplier_dirty.Assign(1);
+        config.interpolation_mode = static_cast<InterpolationMode>(i / 3 % 3);
+        config.interpolation_dirty.Assign(1);
+        config.simple_filter = FilterDesign::Quantize(FilterDesign::OnePoleLowPass(6000.0));
+        config.simple_filter_dirty.Assign(1);
+        config.biquad_filter = FilterDesign::Quantize(FilterDesign::LowPass(2000.0 + 300.0 * static_cast<double>(i), 0.7071));
+        config.biquad_filter_dirty.Assign(1);
+        config.filters_enabled = 3;
+        config.filters_enabled_dirty.Assign(1);
+        config.adpcm_coefficients_dirty.Assign(1);
+
+        config.format.Assign(format);
+        config.mono_or_stereo.Assign(i % 2 && format != Format::ADPCM ? Configuration::MonoOrStereo::Stereo : Configuration::MonoOrStereo::Mono);
+        config.physical_address = 0;
+        config.length = buffer_length;
+        config.buffer_id = 1;
+        config.is_looping.Assign(1);
+        config.embedded_buffer_dirty.Assign(1);
+        config.enable = 1;
+        config.enable_dirty.Assign(1);
+
+        for (size_t c = 0; c < 8; c++) {
+            region.adpcm_coefficients.coeff[i][c * 2 + 0] = static_cast<s16>(1024 + 256 * c);
+            region.adpcm_coefficients.coeff[i][c * 2 + 1] = static_cast<s16>(-512 - 64 * c);
+        }
+    }
+
+    DspConfiguration& dsp = region.dsp_configuration;
+    for (size_t mix = 0; mix < 3; mix++)
+        dsp.volume[mix] = 1.0f;
+    dsp.volume_0_dirty.Assign(1);
+    dsp.volume_1_dirty.Assign(1);
+    dsp.volume_2_dirty.Assign(1);
+    for (size_t i = 0; i < 2; i++) {
+        DspConfiguration::DelayEffect& effect = dsp.delay_effect[i];
+        effect.enable = 1;
+        effect.enable_dirty.Assign(1);
+        effect.frame_count = static_cast<u16>(5 + i);
+        effect.g = 40;
+        effect.a = 90;
+        effect.b = 30;
+        effect.other_dirty.Assign(1);
+    }
+    dsp.delay_effect_0_dirty.Assign(1);
+    dsp.delay_effect_1_dirty.Assign(1);
+}
+
+/// Time per frame of one stage, in microseconds.
+struct Summary {
+    double mean;
+    double median;
+    double p99;
+};
+
+Summary Summarize(std::vector<double> values) {
+    if (values.empty())
+        return {0.0, 0.0, 0.0};
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (double value : values)
+        sum += value;
+    const auto at = [&](double q) { return values[std::min(values.size() - 1, static_cast<size_t>(q * values.size()))]; };
+    return {sum / values.size(), at(0.5), at(0.99)};
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    size_t frames = 200;
+    const char* trace_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            frames = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            trace_path = argv[++i];
+    }
+
+    const std::vector<u8> data = MakeSampleData();
+    const MemoryTranslator memory = [&data](PAddr, u32 size) -> const u8* {
+        return size <= data.size() ? data.data() : nullptr;
+    };
+
+    std::vector<std::unique_ptr<SharedMemory>> regions(frames);
+    for (size_t frame = 0; frame < frames; frame++) {
+        regions[frame] = std::make_unique<SharedMemory>();
+        std::memset(static_cast<void*>(regions[frame].get()), 0, sizeof(SharedMemory));
+        regions[frame]->frame_counter = static_cast<u16>(frame);
+    }
+    ConfigureScene(*regions[0]);
+
+    Engine engine(memory);
+    for (auto& region : regions)
+        engine.Tick(*region);
+
+    // Per-frame sums of each stage.
+    const double microseconds_per_tick = 1e6 / Profiler::TicksPerSecond();
+    std::map<u32, std::array<double, num_stages>> per_frame;
+    size_t events = 0;
+    Profiler::ForEachEvent([&](size_t, const Profiler::Event& event) {
+        const double duration = event.duration * microseconds_per_tick;
+        const size_t stage = static_cast<size_t>(event.stage);
+        per_frame[event.frame][stage] += duration;
+        events++;
+    });
+    if (events == 0) {
+        std::fprintf(stderr, "no events recorded; build the engine with DSP_PROFILE\n");
+        return 1;
+    }
+
+    // Once the ring has wrapped, the oldest frame has lost some of its events.
+    if (events >= Profiler::ring_capacity && !per_frame.empty())
+        per_frame.erase(per_frame.begin());
+
+    std::vector<std::vector<double>> columns(num_stages + 1);
+    for (const auto& [frame, stages] : per_frame) {
+        if (stages[static_cast<size_t>(Stage::Frame)] == 0.0)
+            continue;
+        double leaves = 0.0;
+        for (Stage stage : leaf_stages)
+            leaves += stages[static_cast<size_t>(stage)];
+        for (size_t stage = 0; stage < num_stages; stage++)
+            columns[stage].push_back(stages[stage]);
+        columns[num_stages].push_back(std::max(0.0, stages[static_cast<size_t>(Stage::Frame)] - leaves));
+    }
+
+    const double frame_mean = Summarize(columns[static_cast<size_t>(Stage::Frame)]).mean;
+    std::printf("%zu frames recorded\n\n", columns[0].size());
+    std::printf("%-12s %10s %10s %10s %7s\n", "stage", "mean us", "median us", "p99 us", "share");
+    const auto row = [&](const char* name, const std::vector<double>& values) {
+        const Summary summary = Summarize(values);
+        std::printf("%-12s %10.2f %10.2f %10.2f %6.1f%%\n", name, summary.mean, summary.median, summary.p99,
+                    frame_mean > 0.0 ? 100.0 * summary.mean / frame_mean : 0.0);
+    };
+    for (Stage stage : leaf_stages)
+        row(Profiler::StageName(stage), columns[static_cast<size_t>(stage)]);
+    row("other", columns[num_stages]);
+    row("frame", columns[static_cast<size_t>(Stage::Frame)]);
+
+    if (trace_path) {
+        std::FILE* file = std::fopen(trace_path, "w");
+        if (!file) {
+            std::fprintf(stderr, "cannot write %s\n", trace_path);
+            return 1;
+        }
+        const size_t written = Profiler::WriteChromeTrace(file);
+        std::fclose(file);
+        std::printf("\nwrote %zu events to %s\n", written, trace_path);
+    }
+    return 0;
+}
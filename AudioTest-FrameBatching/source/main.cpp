@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <3ds.h>
+
+#include "engine.h"
+#include "stress_scene.h"
+
+// Engine::Render in batches against Engine::Tick frame by frame, timed on the ARM11. Batching is
+// meant for its 16 KB L1 data cache, which cannot hold every source's state at once.
+//
+// The full-polyphony stress scene is rendered by the HLE engine on the ARM11; the DSP is not used.
+// Each repetition renders it once per variant, in turn, and the median time per frame is reported
+// with the speedup over Tick. Every region must come out byte for byte identical to Tick's.
+// The tuned variant spends all of its frames timing the candidates, so its row includes the cost
+// of tuning; the size it chose is in parentheses. AudioBench-FrameBatching measures the same on a
+// host.
+
+using namespace DSP::HLE;
+
+constexpr size_t NUM_FRAMES = 256;
+constexpr size_t REPEATS = 5;
+constexpr PAddr DATA_ADDRESS = 0x20000000;
+
+using Regions = std::vector<std::unique_ptr<SharedMemory>>;
+
+struct Variant {
+    const char* name;
+    size_t batch; ///< 0 tunes it; Tick when not batched.
+    bool batched;
+    std::vector<double> us_per_frame;
+    size_t chosen;
+};
+
+void waitForKey() {
+    while (aptMainLoop()) {
+        gfxSwapBuffers();
+        gfxFlushBuffers();
+        gspWaitForVBlank();
+
+        hidScanInput();
+        u32 kDown = hidKeysDown();
+
+        if (kDown)
+            break;
+    }
+}
+
+void resetRegions(Regions &regions) {
+    for (size_t frame = 0; frame < regions.size(); frame++) {
+        std::memset(static_cast<void*>(regions[frame].get()), 0, sizeof(SharedMemory));
+        regions[frame]->frame_counter = static_cast<u16>(frame);
+    }
+    StressScene::Configure(*regions[0], DATA_ADDRESS);
+}
+
+double render(const MemoryTranslator &memory, Variant &variant, Regions &regions) {
+    resetRegions(regions);
+    std::vector<SharedMemory*> pointers;
+    for (auto &region : regions)
+        pointers.push_back(region.get());
+
+    // Far larger than the main thread's stack.
+    auto engine = std::make_unique<Engine>(memory);
+    const u64 start = svcGetSystemTick();
+    if (variant.batched) {
+        engine->SetBatchFrames(variant.batch);
+        engine->Render(pointers.data(), pointers.size());
+    } else {
+        for (SharedMemory *region : pointers)
+            engine->Tick(*region);
+    }
+    const u64 end = svcGetSystemTick();
+    variant.chosen = engine->BatchFrames();
+    return static_cast<double>(end - start) * 1e6 / SYSCLOCK_ARM11 / NUM_FRAMES;
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+bool identical(const Regions &a, const Regions &b) {
+    for (size_t frame = 0; frame < a.size(); frame++) {
+        if (memcmp(a[frame].get(), b[frame].get(), sizeof(SharedMemory)) != 0)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    gfxInitDefault();
+
+    PrintConsole botScreen;
+    PrintConsole topScreen;
+
+    consoleInit(GFX_TOP, &topScreen);
+    consoleInit(GFX_BOTTOM, &botScreen);
+    consoleSelect(&topScreen);
+
+    {
+        std::vector<u8> data(StressScene::data_size);
+        StressScene::FillSampleData(data.data());
+        const MemoryTranslator memory = [&data](PAddr address, u32 size) -> const u8* {
+            if (address < DATA_ADDRESS || address - DATA_ADDRESS > data.size() || size > data.size() - (address - DATA_ADDRESS))
+                return nullptr;
+            return data.data() + (address - DATA_ADDRESS);
+        };
+
+        Regions expected(NUM_FRAMES), actual(NUM_FRAMES);
+        for (size_t frame = 0; frame < NUM_FRAMES; frame++) {
+            expected[frame] = std::make_unique<SharedMemory>();
+            actual[frame] = std::make_unique<SharedMemory>();
+        }
+
+        std::vector<Variant> variants = {
+            {"tick", 1, false, {}, 0},
+            {"2", 2, true, {}, 0},
+            {"4", 4, true, {}, 0},
+            {"8", Engine::max_batch_frames, true, {}, 0},
+            {"auto", 0, true, {}, 0},
+        };
+
+        printf("HLE engine on the ARM11: %i frames of %i sources, median of %i\n\n", (int)NUM_FRAMES,
+               (int)AudioCore::num_sources, (int)REPEATS);
+        render(memory, variants[0], expected);
+
+        bool all_match = true;
+        for (size_t i = 0; i < REPEATS; i++) {
+            for (Variant &variant : variants) {
+                variant.us_per_frame.push_back(render(memory, variant, actual));
+                if (i == 0 && !identical(expected, actual)) {
+                    printf("FAIL: %s differs from tick\n", variant.name);
+                    all_match = false;
+                }
+            }
+        }
+
+        const double tick = median(variants[0].us_per_frame);
+        for (const Variant &variant : variants) {
+            const double t = median(variant.us_per_frame);
+            printf("%-5s", variant.name);
+            if (variant.batched && variant.batch == 0)
+                printf(" (%i)", (int)variant.chosen);
+            else
+                printf("    ");
+            printf(" %8.1f us  %.2fx\n", t, t > 0.0 ? tick / t : 1.0);
+        }
+        if (tick == 0.0)
+            printf("The system tick did not advance, so nothing was timed.\n");
+
+        if (all_match)
+            printf("\nTest passed!\n");
+    }
+
+    waitForKey();
+    gfxExit();
+    return 0;
+}
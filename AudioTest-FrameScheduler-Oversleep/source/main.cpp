@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <3ds.h>
+
+#include "audio.h"
+
+// FrameScheduler's dropped-frame count when its tasks overrun the frame period on purpose. Every
+// frame sleeps 1 ms; every 10th sleeps 7 ms instead, which misses one DSP period (about 4.9 ms),
+// and every 25th that is not also a 10th sleeps 11 ms, which misses two. Over 500 frames that is
+// 50 * 1 + 10 * 2 = 70 frames the DSP drops waiting for us.
+//
+// The count is exact where time passes only in the sleeps: on the host stand-in's simulated clock
+// (HOSTCTRU_DSP_CLOCK=simulated, which AudioTool-HostCtru's check uses). On a console, frame
+// work and scheduling jitter can move it by a frame or two.
+
+constexpr size_t NUM_FRAMES = 500;
+constexpr u64 EXPECTED_DROPPED = 70;
+
+void waitForKey() {
+    while (aptMainLoop()) {
+        gfxSwapBuffers();
+        gfxFlushBuffers();
+        gspWaitForVBlank();
+
+        hidScanInput();
+        u32 kDown = hidKeysDown();
+
+        if (kDown)
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    gfxInitDefault();
+
+    PrintConsole botScreen;
+    PrintConsole topScreen;
+
+    consoleInit(GFX_TOP, &topScreen);
+    consoleInit(GFX_BOTTOM, &botScreen);
+    consoleSelect(&topScreen);
+
+    printf("WARNING: This test doesn't handle DSP sleep so don't close your console or you'll have to hard reboot your console\n\n");
+
+    AudioState state;
+    {
+        auto dspfirm = loadDspFirmFromFile();
+        if (!dspfirm) {
+            printf("Couldn't load firmware\n");
+            goto end;
+        }
+        auto ret = audioInit(*dspfirm);
+        if (!ret) {
+            printf("Couldn't init audio\n");
+            goto end;
+        }
+        state = *ret;
+    }
+
+    {
+        FrameScheduler scheduler(state);
+
+        scheduler.beginFrame();
+        initSharedMem(state);
+        scheduler.endFrame();
+
+        scheduler.everyFrame([&](AudioState&) {
+            if (scheduler.frame() % 10 == 0) {
+                svcSleepThread(7000000);
+            } else if (scheduler.frame() % 25 == 0) {
+                svcSleepThread(11000000);
+            } else {
+                svcSleepThread(1000000);
+            }
+        });
+        scheduler.runFrames(NUM_FRAMES);
+        scheduler.endFrame();
+
+        const FrameScheduler::Stats& stats = scheduler.stats();
+        printf("%llu frames, %llu late, %llu dropped, longest %llu ticks\n", stats.frames, stats.late_frames,
+               stats.dropped_frames, stats.max_ticks);
+
+        if (stats.dropped_frames == EXPECTED_DROPPED) {
+            printf("Test passed!\n");
+        } else {
+            printf("FAIL: expected %llu dropped frames\n", EXPECTED_DROPPED);
+        }
+    }
+
+end:
+    waitForKey();
+    audioExit(state);
+    gfxExit();
+    return 0;
+}
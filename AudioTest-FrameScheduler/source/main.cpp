@@ -0,0 +1,193 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <3ds.h>
+
+#include "audio.h"
+
+// The AudioTest-SourceStatus scenario driven by FrameScheduler and staged through ConfigWriter:
+// tasks keep the buffer queue topped up and restart the source if it stops, then the queue runs
+// dry. The log should read as SourceStatus's does, followed by the scheduler's frame statistics.
+
+// World's worst triangle wave generator.
+// Generates PCM16.
+void fillBuffer(u32 *audio_buffer, size_t size, unsigned freq) {
+    for (size_t i = 0; i < size; i++) {
+        u32 data = (i % freq) * 256;
+        audio_buffer[i] = (data<<16) | (data&0xFFFF);
+    }
+
+    DSP_FlushDataCache(audio_buffer, size);
+}
+
+void waitForKey() {
+    while (aptMainLoop()) {
+        gfxSwapBuffers();
+        gfxFlushBuffers();
+        gspWaitForVBlank();
+
+        hidScanInput();
+        u32 kDown = hidKeysDown();
+
+        if (kDown)
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    gfxInitDefault();
+
+    PrintConsole botScreen;
+    PrintConsole topScreen;
+
+    consoleInit(GFX_TOP, &topScreen);
+    consoleInit(GFX_BOTTOM, &botScreen);
+    consoleSelect(&topScreen);
+
+    printf("WARNING: This test doesn't handle DSP sleep so don't close your console or you'll have to hard reboot your console\n\n");
+
+    constexpr size_t NUM_SAMPLES = 160*200;
+    u32 *audio_buffer = (u32*)linearAlloc(NUM_SAMPLES * sizeof(u32));
+    fillBuffer(audio_buffer, NUM_SAMPLES, 160);
+    u32 *audio_buffer2 = (u32*)linearAlloc(NUM_SAMPLES * sizeof(u32));
+    fillBuffer(audio_buffer2, NUM_SAMPLES, 80);
+    u32 *audio_buffer3 = (u32*)linearAlloc(NUM_SAMPLES * sizeof(u32));
+    fillBuffer(audio_buffer3, NUM_SAMPLES, 40);
+
+    AudioState state;
+    {
+        auto dspfirm = loadDspFirmFromFile();
+        if (!dspfirm) {
+            printf("Couldn't load firmware\n");
+            goto end;
+        }
+        auto ret = audioInit(*dspfirm);
+        if (!ret) {
+            printf("Couldn't init audio\n");
+            goto end;
+        }
+        state = *ret;
+    }
+
+    {
+        FrameScheduler scheduler(state);
+        // The region the DSP returned alternates between frames, so look it up every time.
+        auto status = [&]() -> volatile DSP::HLE::SourceStatus::Status& { return state.read().source_statuses->status[0]; };
+
+        scheduler.beginFrame();
+        initSharedMem(state);
+        scheduler.endFrame();
+        printf("init\n");
+
+        scheduler.runFrames(4);
+
+        scheduler.runUntil([&](const AudioState&) {
+            printf("sync = %i, play = %i\n", status().sync, status().is_enabled);
+            return status().sync == 1;
+        });
+        printf("fi: %i\n", state.frame_id);
+
+        u16 buffer_id = 0;
+        size_t next_queue_position = 0;
+
+        ConfigWriter writer(state);
+        auto& config = writer.source(0);
+        config.play_position = 0;
+        config.physical_address = osConvertVirtToPhys(audio_buffer3);
+        config.length = NUM_SAMPLES;
+        config.mono_or_stereo.Assign(DSP::HLE::SourceConfiguration::Configuration::MonoOrStereo::Stereo);
+        config.format.Assign(DSP::HLE::SourceConfiguration::Configuration::Format::PCM16);
+        config.fade_in.Assign(false);
+        config.adpcm_dirty.Assign(false);
+        config.is_looping.Assign(false);
+        config.buffer_id = ++buffer_id;
+        config.partial_reset_flag.Assign(true);
+        config.play_position_dirty.Assign(true);
+        config.embedded_buffer_dirty.Assign(true);
+
+        auto queueBuffer = [&](DSP::HLE::SourceConfiguration::Configuration& config) {
+            config.buffers[next_queue_position].physical_address = osConvertVirtToPhys(buffer_id % 2 ? audio_buffer2 : audio_buffer);
+            config.buffers[next_queue_position].length = NUM_SAMPLES;
+            config.buffers[next_queue_position].adpcm_dirty = false;
+            config.buffers[next_queue_position].is_looping = false;
+            config.buffers[next_queue_position].buffer_id = ++buffer_id;
+            config.buffers_dirty |= 1 << next_queue_position;
+            next_queue_position = (next_queue_position + 1) % 4;
+            config.buffer_queue_dirty.Assign(true);
+        };
+        queueBuffer(config);
+        config.enable = true;
+        config.enable_dirty.Assign(true);
+
+        writer.commit();
+        scheduler.endFrame();
+
+        // Keep the queue topped up, restarting the source if it ever stops.
+        const u64 first_frame = scheduler.frame() + 1;
+        auto frameCount = [&] { return static_cast<int>(scheduler.frame() - first_frame); };
+        const auto restart = scheduler.everyFrame([&](AudioState& s) {
+            if (!status().is_enabled) {
+                printf("%i !\n", frameCount());
+                ConfigWriter writer(s);
+                writer.source(0).enable = true;
+                writer.source(0).enable_dirty.Assign(true);
+            }
+        });
+        const auto refill = scheduler.onBufferChange(0, [&](AudioState& s, u16 current_buffer_id) {
+            printf("%i %i (curr:%i)\n", frameCount(), current_buffer_id, buffer_id+1);
+            if (current_buffer_id == buffer_id || current_buffer_id == 0) {
+                ConfigWriter writer(s);
+                queueBuffer(writer.source(0));
+            }
+        });
+        scheduler.runFrames(1950);
+        scheduler.cancel(restart);
+        scheduler.cancel(refill);
+
+        // Let the queue run dry.
+        u16 prev_read_bid = status().current_buffer_id;
+        const auto watch = scheduler.everyFrame([&](AudioState&) {
+            if (!status().is_enabled) {
+                printf("%i !\n", frameCount());
+            }
+
+            if (status().current_buffer_id_dirty) {
+                printf("%i d\n", frameCount());
+            }
+
+            if (prev_read_bid != status().current_buffer_id) {
+                printf("%i %i\n", frameCount(), status().current_buffer_id);
+                prev_read_bid = status().current_buffer_id;
+            }
+        });
+        scheduler.runFrames(2208 - 1950);
+        scheduler.cancel(watch);
+
+        printf("last buf id %i\n", buffer_id);
+
+        scheduler.beginFrame();
+        {
+            ConfigWriter writer(state);
+            writer.source(0).sync = 2;
+            writer.source(0).sync_dirty.Assign(true);
+        }
+        scheduler.endFrame();
+
+        scheduler.runUntil([&](const AudioState&) {
+            printf("sync = %i, play = %i\n", status().sync, status().is_enabled);
+            return status().sync == 2;
+        });
+        scheduler.endFrame();
+
+        const FrameScheduler::Stats& stats = scheduler.stats();
+        printf("Done! %llu frames, %llu late, %llu dropped, longest %llu ticks\n", stats.frames, stats.late_frames,
+               stats.dropped_frames, stats.max_ticks);
+    }
+
+end:
+    waitForKey();
+    audioExit(state);
+    gfxExit();
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <3ds.h>
+
+#include "audio.h"
+#include "stress_scene.h"
+
+// Full polyphony: every source playing the stress scene (every format and interpolation mode,
+// both filters, all three mixers, both delay effects).
+//
+// First the scene is rendered by MerryAudio's HLE engine, running on the ARM11, to find the
+// worst-case time of a frame of the engine on the device; AudioBench-FullPolyphony measures the
+// same on a host. This times the engine, not the DSP: the DSP's own time is not visible from the
+// ARM11. Then the DSP plays the scene for ten seconds, checking that no source stops and counting
+// the frames we made it drop.
+
+using namespace DSP::HLE;
+
+constexpr size_t ENGINE_FRAMES = 1000;
+constexpr size_t DSP_FRAMES = 2000;
+
+void waitForKey() {
+    while (aptMainLoop()) {
+        gfxSwapBuffers();
+        gfxFlushBuffers();
+        gspWaitForVBlank();
+
+        hidScanInput();
+        u32 kDown = hidKeysDown();
+
+        if (kDown)
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    gfxInitDefault();
+
+    PrintConsole botScreen;
+    PrintConsole topScreen;
+
+    consoleInit(GFX_TOP, &topScreen);
+    consoleInit(GFX_BOTTOM, &botScreen);
+    consoleSelect(&topScreen);
+
+    {
+        printf("HLE engine on the ARM11, not the DSP: %i frames of %i sources\n", (int)ENGINE_FRAMES,
+               (int)AudioCore::num_sources);
+        const StressScene::Measurement measurement = StressScene::Measure(ENGINE_FRAMES);
+        const StressScene::Summary summary = StressScene::Summarize(measurement);
+        const double budget = StressScene::frame_budget_us;
+        printf("mean %.1f us, median %.1f us, p99 %.1f us\n", summary.mean, summary.median, summary.p99);
+        printf("worst %.1f us (frame %i), %.1f%% of %.1f us\n", summary.max, (int)summary.worst_frame,
+               100.0 * summary.max / budget, budget);
+        if (measurement.min_active_sources != AudioCore::num_sources)
+            printf("FAIL: only %i sources kept playing\n", (int)measurement.min_active_sources);
+    }
+
+    u8 *audio_buffer = (u8*)linearAlloc(StressScene::data_size);
+    StressScene::FillSampleData(audio_buffer);
+    DSP_FlushDataCache(audio_buffer, StressScene::data_size);
+
+    AudioState state;
+    {
+        auto dspfirm = loadDspFirmFromFile();
+        if (!dspfirm) {
+            printf("Couldn't load firmware\n");
+            goto end;
+        }
+        auto ret = audioInit(*dspfirm);
+        if (!ret) {
+            printf("Couldn't init audio\n");
+            goto end;
+        }
+        state = *ret;
+    }
+
+    {
+        FrameScheduler scheduler(state);
+
+        scheduler.beginFrame();
+        initSharedMem(state);
+        scheduler.endFrame();
+
+        scheduler.beginFrame();
+        {
+            ConfigWriter writer(state);
+            for (size_t i = 0; i < AudioCore::num_sources; i++)
+                StressScene::ConfigureSource(i, writer.source(i), osConvertVirtToPhys(audio_buffer));
+            StressScene::ConfigureMixers(writer.dsp());
+        }
+        {
+            DSP::HLE::AdpcmCoefficients coefficients;
+            StressScene::ConfigureAdpcm(coefficients);
+            memcpy(const_cast<DSP::HLE::AdpcmCoefficients*>(state.write().adpcm_coefficients), &coefficients, sizeof(coefficients));
+        }
+        scheduler.endFrame();
+
+        // The statuses of the configuring frame come back with the next one.
+        scheduler.runFrames(1);
+
+        int min_active = AudioCore::num_sources;
+        scheduler.everyFrame([&](AudioState &s) {
+            int active = 0;
+            for (size_t i = 0; i < AudioCore::num_sources; i++)
+                active += s.read().source_statuses->status[i].is_enabled ? 1 : 0;
+            if (active < min_active)
+                min_active = active;
+        });
+        scheduler.runFrames(DSP_FRAMES);
+        scheduler.endFrame();
+
+        const FrameScheduler::Stats& stats = scheduler.stats();
+        printf("dsp: %llu frames, %llu late, %llu dropped, longest %llu ticks\n", stats.frames, stats.late_frames,
+               stats.dropped_frames, stats.max_ticks);
+        if (min_active == (int)AudioCore::num_sources) {
+            printf("Test passed!\n");
+        } else {
+            printf("FAIL: only %i sources kept playing\n", min_active);
+        }
+    }
+
+end:
+    audioExit(state);
+    waitForKey();
+    gfxExit();
+    return 0;
+}
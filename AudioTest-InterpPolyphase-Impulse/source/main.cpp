@@ -152,6 +152,19 @@ int main(int argc, char **argv) {
                         }
                         continue_reading = false;
                         printf("\n");
+
+                        // The kernel is centred where None and Linear read: the impulse is two
+                        // input samples in, so its peak is the output at position 2.
+                        size_t peak = 0;
+                        for (size_t j = 1; j < 160; j++) {
+                            if (abs((s32)state.write().intermediate_mix_samples->mix1.pcm32[0][j]) >
+                                abs((s32)state.write().intermediate_mix_samples->mix1.pcm32[0][peak]))
+                                peak = j;
+                        }
+                        size_t expected_peak = (size_t)lround(2.0f / rate_multiplier);
+                        printf("peak=%i expect=%i\n", peak, expected_peak);
+                        if (peak != expected_peak)
+                            passed = false;
                         break;
                     }
                 }
@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "dsp.h"
+#include "engine.h"
+#include "random.h"
+
+// Fuzzes the engine with random sequences of SourceConfiguration edits and checks invariants on
+// the SourceStatus it reports back.
+//
+// Each sequence starts from a reset engine and applies, frame by frame, the kinds of edits an
+// application makes: enabling and disabling, embedded buffers, queue pushes through buffers_dirty,
+// partial_reset_flag and reset_flag in the middle of a queue, sync, rate, interpolation and filter
+// changes. A shadow model of what the application wrote is checked against every status:
+//
+//   - sync echoes the last sync written;
+//   - a source the application disabled (or reset) reports is_enabled = 0;
+//   - an enabled source reports a buffer, and a reported buffer_id was queued and not dropped by a
+//     reset since;
+//   - buffer_position lies inside the reported buffer, and does not go backwards within a
+//     playthrough of a non-looping buffer.
+//
+// Sequences are numbered from the seed and spread over all cores. The first violation stops the
+// run and prints the sequence seed; `-r <seed>` replays it with a per-frame trace.
+//
+//     AudioTool-ConfigFuzzer [-s seconds] [-t threads] [-S base seed] [-r sequence seed]
+
+using namespace DSP::HLE;
+
+using Configuration = SourceConfiguration::Configuration;
+
+namespace {
+
+constexpr size_t frames_per_sequence = 2000;
+constexpr u32 max_buffer_length = 4000;
+
+/// Sample memory for every buffer: silence, large enough for the longest stereo PCM16 buffer.
+const std::vector<u8> sample_memory(max_buffer_length * 4);
+
+/// What the application has told one source, as far as the invariants need it.
+struct Shadow {
+    struct BufferInfo {
+        u32 length;
+        bool looping;
+    };
+
+    /// Buffers that may still be reported, by id: those queued since the last reset, less those a
+    /// partial reset dropped. Ids are never reused within a sequence.
+    std::unordered_map<u16, BufferInfo> buffers;
+    u16 next_id = 1;
+    u16 sync = 0;
+    bool enabled = false;
+
+    u16 previous_id = 0;
+    u32 previous_position = 0;
+    bool reset_this_frame = false;
+};
+
+struct Violation {
+    u64 seed;
+    size_t frame;
+    size_t source;
+    const char* what;
+    SourceStatus::Status status;
+};
+
+/// Writes this frame's random edits for one source into its configuration.
+void Edit(Random& rng, Configuration& config, Shadow& shadow, bool audible) {
+    shadow.reset_this_frame = false;
+    if (rng.Chance(70))
+        return;
+
+    if (rng.Chance(4)) {
+        config.reset_flag.Assign(1);
+        shadow.buffers.clear();
+        shadow.sync = 0;
+        shadow.enabled = false;
+        shadow.reset_this_frame = true;
+    }
+    if (rng.Chance(6)) {
+        // The waiting buffers are dropped. The one playing finishes, but no longer loops.
+        config.partial_reset_flag.Assign(1);
+        const auto playing = shadow.buffers.find(shadow.previous_id);
+        const bool was_playing = playing != shadow.buffers.end();
+        const Shadow::BufferInfo info = was_playing ? playing->second : Shadow::BufferInfo{};
+        shadow.buffers.clear();
+        if (was_playing)
+            shadow.buffers[shadow.previous_id] = {info.length, false};
+    }
+
+    if (rng.Chance(12)) {
+        config.enable = rng.Chance(75) ? 1 : 0;
+        config.enable_dirty.Assign(1);
+        shadow.enabled = config.enable != 0;
+    }
+
+    if (rng.Chance(15)) {
+        shadow.sync = static_cast<u16>(rng.Next());
+        config.sync = shadow.sync;
+        config.sync_dirty.Assign(1);
+    }
+
+    if (rng.Chance(12)) {
+        config.rate_multiplier = rng.Chance(10) ? 0.0f : rng.Between(0.05f, 12.0f);
+        config.rate_multiplier_dirty.Assign(1);
+    }
+
+    if (rng.Chance(6)) {
+        config.interpolation_mode = static_cast<Configuration::InterpolationMode>(rng.Below(3));
+        config.interpolation_dirty.Assign(1);
+    }
+
+    if (rng.Chance(6)) {
+        config.filters_enabled = static_cast<u16>(rng.Below(4));
+        config.filters_enabled_dirty.Assign(1);
+        config.simple_filter = {static_cast<s16>(rng.Next()), static_cast<s16>(rng.Below(0x7000))};
+        config.simple_filter_dirty.Assign(1);
+        config.biquad_filter = {static_cast<s16>(-static_cast<s16>(rng.Below(0x2000))), static_cast<s16>(rng.Below(0x4000)),
+                                static_cast<s16>(rng.Next()), static_cast<s16>(rng.Next()), static_cast<s16>(rng.Next())};
+        config.biquad_filter_dirty.Assign(1);
+    }
+
+    if (audible && rng.Chance(10)) {
+        for (auto& mixer : config.gain) {
+            for (auto& gain : mixer)
+                gain = rng.Chance(50) ? 0.0f : rng.Between(0.0f, 1.0f);
+        }
+        config.gain_0_dirty.Assign(1);
+        config.gain_1_dirty.Assign(1);
+        config.gain_2_dirty.Assign(1);
+    }
+
+    if (rng.Chance(20)) {
+        const u32 length = rng.Chance(10) ? 0 : 1 + rng.Below(max_buffer_length);
+        const bool looping = rng.Chance(30);
+        config.format.Assign(static_cast<Configuration::Format>(rng.Below(3)));
+        config.mono_or_stereo.Assign(rng.Chance(50) ? Configuration::MonoOrStereo::Stereo : Configuration::MonoOrStereo::Mono);
+        config.physical_address = 0;
+        config.length = length;
+        config.buffer_id = shadow.next_id;
+        config.is_looping.Assign(looping);
+        config.adpcm_dirty.Assign(rng.Chance(50));
+        config.fade_in.Assign(rng.Chance(20));
+        if (rng.Chance(30)) {
+            config.play_position = rng.Below(length + 100);
+            config.play_position_dirty.Assign(1);
+        }
+        config.embedded_buffer_dirty.Assign(1);
+        shadow.buffers[shadow.next_id++] = {length, looping};
+    }
+
+    if (rng.Chance(40)) {
+        // One to four of the slots, each written once.
+        const u32 slots = 1 + rng.Below(15);
+        for (size_t slot = 0; slot < 4; slot++) {
+            if (!(slots & (1 << slot)))
+                continue;
+            auto& buffer = config.buffers[slot];
+            const u32 length = rng.Chance(10) ? 0 : 1 + rng.Below(max_buffer_length);
+            const bool looping = rng.Chance(10);
+            buffer.physical_address = 0;
+            buffer.length = length;
+            buffer.buffer_id = shadow.next_id;
+            buffer.is_looping = looping ? 1 : 0;
+            buffer.adpcm_dirty = rng.Chance(50) ? 1 : 0;
+            config.buffers_dirty |= static_cast<u16>(1 << slot);
+            shadow.buffers[shadow.next_id++] = {length, looping};
+        }
+        config.buffer_queue_dirty.Assign(1);
+    }
+}
+
+/// Checks one status against the shadow. Returns the broken invariant, or nullptr.
+const char* Check(const SourceStatus::Status& status, Shadow& shadow) {
+    const u16 id = status.current_buffer_id;
+    const u32 position = status.buffer_position;
+
+    const char* broken = nullptr;
+    const auto buffer = shadow.buffers.find(id);
+    if (status.sync != shadow.sync)
+        broken = "sync does not echo the last sync written";
+    else if (status.is_enabled && !shadow.enabled)
+        broken = "source reports enabled after being disabled or reset";
+    else if (status.is_enabled && id == 0)
+        broken = "enabled source reports no buffer";
+    else if (id != 0 && buffer == shadow.buffers.end())
+        broken = "current_buffer_id was never queued, or was dropped by a reset";
+    else if (id != 0 && position >= buffer->second.length)
+        broken = "buffer_position is past the end of the buffer";
+    else if (id != 0 && id == shadow.previous_id && !buffer->second.looping && !shadow.reset_this_frame &&
+             position < shadow.previous_position)
+        broken = "buffer_position went backwards within a non-looping buffer";
+
+    shadow.previous_id = id;
+    shadow.previous_position = position;
+    return broken;
+}
+
+void PrintTrace(size_t frame, size_t source, u32 dirty, const SourceStatus::Status& status) {
+    printf("frame %5zu source %2zu dirty %08" PRIx32 " -> enabled %u id %5u%s position %5u sync %5u\n", frame, source,
+           dirty, static_cast<unsigned>(status.is_enabled), static_cast<unsigned>(status.current_buffer_id),
+           status.current_buffer_id_dirty ? "*" : " ", static_cast<u32>(status.buffer_position),
+           static_cast<unsigned>(status.sync));
+}
+
+/// Runs one sequence. Returns false and fills `violation` on the first broken invariant.
+bool RunSequence(u64 seed, Engine& engine, SharedMemory& region, Violation& violation, size_t& active, bool trace) {
+    Random rng(seed);
+    engine.Reset();
+    std::memset(static_cast<void*>(&region), 0, sizeof(SharedMemory));
+
+    active = 1 + rng.Below(AudioCore::num_sources);
+    const bool audible = rng.Chance(10);
+    std::vector<Shadow> shadows(active);
+
+    for (size_t frame = 0; frame < frames_per_sequence; frame++) {
+        std::vector<u32> dirty(trace ? active : 0);
+        for (size_t i = 0; i < active; i++) {
+            Configuration& config = region.source_configurations.config[i];
+            Edit(rng, config, shadows[i], audible);
+            if (trace)
+                dirty[i] = config.dirty_raw;
+        }
+
+        engine.Tick(region);
+
+        for (size_t i = 0; i < active; i++) {
+            const SourceStatus::Status& status = region.source_statuses.status[i];
+            if (trace && (dirty[i] != 0 || status.current_buffer_id_dirty))
+                PrintTrace(frame, i, dirty[i], status);
+
+            if (const char* broken = Check(status, shadows[i])) {
+                violation = {seed, frame, i, broken, status};
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+struct Totals {
+    std::atomic<u64> sequences{0};
+    std::atomic<u64> frames{0};
+    std::atomic<u64> source_frames{0}; ///< Frames times active sources.
+    std::atomic<bool> stop{false};
+    std::mutex mutex;
+    bool failed = false;
+    Violation violation{};
+};
+
+void Worker(u64 first_seed, u64 stride, Totals& totals) {
+    Engine engine([](PAddr, u32 size) { return size <= sample_memory.size() ? sample_memory.data() : nullptr; });
+    auto region = std::make_unique<SharedMemory>();
+
+    for (u64 seed = first_seed; !totals.stop.load(std::memory_order_relaxed); seed += stride) {
+        Violation violation;
+        size_t active;
+        const bool passed = RunSequence(seed, engine, *region, violation, active, false);
+        const u64 frames = passed ? frames_per_sequence : violation.frame + 1;
+        totals.sequences.fetch_add(1, std::memory_order_relaxed);
+        totals.frames.fetch_add(frames, std::memory_order_relaxed);
+        totals.source_frames.fetch_add(frames * active, std::memory_order_relaxed);
+
+        if (!passed) {
+            std::lock_guard<std::mutex> lock(totals.mutex);
+            if (!totals.failed) {
+                totals.failed = true;
+                totals.violation = violation;
+            }
+            totals.stop = true;
+        }
+    }
+}
+
+int Replay(u64 seed) {
+    Engine engine([](PAddr, u32 size) { return size <= sample_memory.size() ? sample_memory.data() : nullptr; });
+    auto region = std::make_unique<SharedMemory>();
+    Violation violation;
+    size_t active;
+    if (RunSequence(seed, engine, *region, violation, active, true)) {
+        printf("sequence %" PRIu64 ": all invariants hold\n", seed);
+        return 0;
+    }
+    printf("sequence %" PRIu64 ", frame %zu, source %zu: %s\n", seed, violation.frame, violation.source, violation.what);
+    return 1;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    double seconds = 10.0;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    u64 base_seed = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "-s") == 0)
+            seconds = std::atof(argv[i + 1]);
+        else if (std::strcmp(argv[i], "-t") == 0)
+            threads = std::max(1, std::atoi(argv[i + 1]));
+        else if (std::strcmp(argv[i], "-S") == 0)
+            base_seed = std::strtoull(argv[i + 1], nullptr, 0);
+        else if (std::strcmp(argv[i], "-r") == 0)
+            return Replay(std::strtoull(argv[i + 1], nullptr, 0));
+    }
+
+    printf("fuzzing for %.0fs on %u threads, %zu frames per sequence\n", seconds, threads, frames_per_sequence);
+
+    Totals totals;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++)
+        workers.emplace_back(Worker, base_seed + t, threads, std::ref(totals));
+
+    while (!totals.stop && std::chrono::steady_clock::now() - start < std::chrono::duration<double>(seconds))
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    totals.stop = true;
+    for (auto& worker : workers)
+        worker.join();
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const u64 frames = totals.frames;
+    printf("%" PRIu64 " sequences, %" PRIu64 " frames, %.0f frames/s, %.0f source frames/s\n",
+           static_cast<u64>(totals.sequences), frames, static_cast<double>(frames) / elapsed,
+           static_cast<double>(totals.source_frames) / elapsed);
+
+    if (totals.failed) {
+        const Violation& v = totals.violation;
+        printf("\nsequence %" PRIu64 ", frame %zu, source %zu: %s\n", v.seed, v.frame, v.source, v.what);
+        printf("status: enabled %u id %u position %u sync %u\n", static_cast<unsigned>(v.status.is_enabled),
+               static_cast<unsigned>(v.status.current_buffer_id), static_cast<u32>(v.status.buffer_position),
+               static_cast<unsigned>(v.status.sync));
+        printf("replay with: %s -r %" PRIu64 "\n", argv[0], v.seed);
+        return 1;
+    }
+
+    printf("no invariant broken\n");
+    return 0;
+}
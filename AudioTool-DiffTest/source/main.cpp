@@ -0,0 +1,605 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "dsp.h"
+#include "engine.h"
+#include "filter_design.h"
+#include "random.h"
+
+// Differential tester: runs two engine variants on the same stream of frames in lockstep and
+// pinpoints where their output first diverges.
+//
+// Both variants render the same scripted scene, a chunk of frames at a time. Every frame is
+// reduced to a few hashes (one per source status, the auxiliary mixes, the final mix), which is
+// all that is compared while the outputs agree. Both engines are checkpointed every
+// checkpoint_interval frames. On the first mismatching frame both are rewound to the last
+// checkpoint and replayed with a probe attached, and the intermediate results of that frame are
+// compared stage by stage: each source's output, each source's status, the intermediate mixes,
+// the effect output and the final mix. The first differing sample is reported.
+//
+// Variants that cannot run in one process, such as two revisions or builds with different flags,
+// are compared through hash files: `-w` records the hashes of one run, `-c` checks another run
+// against them, and `-x <frame>` prints per-stage hashes of one frame to diff between the builds.
+//
+//     AudioTool-DiffTest [-a variant] [-b variant] [-n frames] [-S seed]
+//     AudioTool-DiffTest [-a variant] [-n frames] [-S seed] (-w file | -c file | -x frame)
+
+using namespace DSP::HLE;
+
+using Configuration = SourceConfiguration::Configuration;
+
+namespace {
+
+/// Frames the script writes ahead before the sides process them, a whole batch for Render.
+constexpr size_t chunk_frames = Engine::max_batch_frames;
+constexpr size_t checkpoint_interval = 32 * chunk_frames;
+constexpr u32 sample_memory_size = 1 << 20;
+
+struct Variant {
+    const char* name;
+    const char* description;
+    Precision precision;
+    u16 silence_threshold;
+    bool batched;
+    bool skip_muted;
+};
+
+constexpr Variant variants[] = {
+    {"exact", "bit-exact, one Tick per frame", Precision::BitExact, 0, false, true},
+    {"batch", "bit-exact, Render in tuned batches", Precision::BitExact, 0, true, true},
+    {"preview", "float preview pipelines", Precision::Preview, 0, false, true},
+    {"gate", "bit-exact, quiet sources skipped below a peak of 64", Precision::BitExact, 64, false, true},
+    {"render", "bit-exact, muted sources rendered instead of skipped", Precision::BitExact, 0, false, false},
+};
+
+const Variant* FindVariant(const char* name) {
+    for (const Variant& variant : variants) {
+        if (std::strcmp(variant.name, name) == 0)
+            return &variant;
+    }
+    return nullptr;
+}
+
+/// Sample memory shared by every buffer: noisy tones, so every stage has something to do.
+const std::vector<u8> sample_memory = [] {
+    std::vector<u8> data(sample_memory_size);
+    u32 noise = 1;
+    for (size_t i = 0; i < data.size() / 2; i++) {
+        noise = noise * 1664525 + 1013904223;
+        const double tone = std::sin(static_cast<double>(i) * 0.013) * 12000.0 + std::sin(static_cast<double>(i) * 0.31) * 4000.0;
+        const s16 sample = static_cast<s16>(tone + static_cast<double>(static_cast<s32>(noise >> 20) - 2048));
+        std::memcpy(&data[i * 2], &sample, 2);
+    }
+    return data;
+}();
+
+/**
+ * The scene: all 24 sources playing looping buffers with assorted formats, rates, interpolation
+ * modes and filters, then a stream of edits. Every field a dirty flag makes the engine read is
+ * written along with the flag, so the script does not depend on what a region held before.
+ * Copying a Script saves its position in the stream.
+ */
+class Script {
+public:
+    explicit Script(u64 seed) : rng(seed) {}
+
+    /// Writes the configuration of the next frame into `region`.
+    void Write(SharedMemory& region, size_t frame) {
+        region.frame_counter = static_cast<u16>(frame);
+        if (frame == 0) {
+            for (size_t i = 0; i < AudioCore::num_sources; i++)
+                StartSource(region, i);
+            for (size_t mixer = 0; mixer < 3; mixer++)
+                region.dsp_configuration.volume[mixer] = 1.0f;
+            region.dsp_configuration.volume_0_dirty.Assign(1);
+            region.dsp_configuration.volume_1_dirty.Assign(1);
+            region.dsp_configuration.volume_2_dirty.Assign(1);
+            region.dsp_configuration.mixer1_enabled = 1;
+            region.dsp_configuration.mixer1_enabled_dirty.Assign(1);
+            DelayEffect(region.dsp_configuration.delay_effect[0]);
+            region.dsp_configuration.delay_effect_0_dirty.Assign(1);
+            return;
+        }
+
+        for (size_t i = 0; i < AudioCore::num_sources; i++) {
+            Configuration& config = region.source_configurations.config[i];
+            if (rng.Chance(1))
+                StartSource(region, i);
+            if (rng.Chance(3))
+                Gains(config);
+            else if (rng.Chance(1))
+                Mute(config);
+            if (rng.Chance(2)) {
+                config.rate_multiplier = Rate();
+                config.rate_multiplier_dirty.Assign(1);
+            }
+            if (rng.Chance(1))
+                Filters(config);
+        }
+    }
+
+private:
+    void StartSource(SharedMemory& region, size_t i) {
+        Configuration& config = region.source_configurations.config[i];
+        const auto format = static_cast<Configuration::Format>(rng.Below(3));
+        const bool stereo = format != Configuration::Format::ADPCM && rng.Chance(50);
+
+        config.format.Assign(format);
+        config.mono_or_stereo.Assign(stereo ? Configuration::MonoOrStereo::Stereo : Configuration::MonoOrStereo::Mono);
+        config.physical_address = rng.Below(sample_memory_size / 2);
+        config.length = 2000 + rng.Below(40000);
+        config.buffer_id = static_cast<u16>(next_id++);
+        config.is_looping.Assign(1);
+        config.adpcm_dirty.Assign(1);
+        config.adpcm_yn[0] = 0;
+        config.adpcm_yn[1] = 0;
+        config.fade_in.Assign(rng.Chance(30));
+        config.play_position = 0;
+        config.embedded_buffer_dirty.Assign(1);
+        config.enable = 1;
+        config.enable_dirty.Assign(1);
+
+        config.rate_multiplier = Rate();
+        config.rate_multiplier_dirty.Assign(1);
+        config.interpolation_mode = static_cast<Configuration::InterpolationMode>(rng.Below(3));
+        config.interpolation_related = static_cast<u8>(rng.Below(4));
+        config.interpolation_dirty.Assign(1);
+
+        for (size_t c = 0; c < 8; c++) {
+            region.adpcm_coefficients.coeff[i][c * 2 + 0] = static_cast<s16>(1024 + 200 * c);
+            region.adpcm_coefficients.coeff[i][c * 2 + 1] = static_cast<s16>(-400 - 80 * c);
+        }
+        config.adpcm_coefficients_dirty.Assign(1);
+
+        Gains(config);
+        Filters(config);
+    }
+
+    /// One rate in five is at least 8, where Source fetches PCM input only around the samples the
+    /// interpolator reads (see sparse_fetch_rate); 16 is the highest rate modelled.
+    float Rate() {
+        return rng.Chance(20) ? rng.Between(8.0f, 16.0f) : rng.Between(0.3f, 4.0f);
+    }
+
+    void Gains(Configuration& config) {
+        for (auto& mixer : config.gain) {
+            for (auto& gain : mixer)
+                gain = rng.Chance(40) ? rng.Between(0.0f, 0.15f) : 0.0f;
+        }
+        config.gain_0_dirty.Assign(1);
+        config.gain_1_dirty.Assign(1);
+        config.gain_2_dirty.Assign(1);
+    }
+
+    /// Zeroes every gain until the next Gains. With a filter on, the source must still be rendered.
+    void Mute(Configuration& config) {
+        for (auto& mixer : config.gain) {
+            for (auto& gain : mixer)
+                gain = 0.0f;
+        }
+        config.gain_0_dirty.Assign(1);
+        config.gain_1_dirty.Assign(1);
+        config.gain_2_dirty.Assign(1);
+    }
+
+    void Filters(Configuration& config) {
+        config.filters_enabled = static_cast<u16>(rng.Below(4));
+        config.filters_enabled_dirty.Assign(1);
+        config.simple_filter = FilterDesign::Quantize(FilterDesign::OnePoleLowPass(rng.Between(500.0f, 12000.0f)));
+        config.simple_filter_dirty.Assign(1);
+        config.biquad_filter = FilterDesign::Quantize(FilterDesign::Peaking(rng.Between(200.0f, 8000.0f), 1.0, rng.Between(-12.0f, 12.0f)));
+        config.biquad_filter_dirty.Assign(1);
+    }
+
+    void DelayEffect(DspConfiguration::DelayEffect& effect) {
+        effect.enable = 1;
+        effect.enable_dirty.Assign(1);
+        effect.frame_count = 5;
+        effect.g = 40;
+        effect.a = 90;
+        effect.b = 30;
+        effect.other_dirty.Assign(1);
+    }
+
+    Random rng;
+    u32 next_id = 1;
+};
+
+/// FNV-1a.
+u64 Hash(const void* data, size_t size, u64 hash = 0xCBF29CE484222325ull) {
+    const u8* bytes = static_cast<const u8*>(data);
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    return hash;
+}
+
+/// The output of one frame, reduced to a hash per component.
+struct FrameHashes {
+    std::array<u64, AudioCore::num_sources> status;
+    u64 auxiliary; ///< mix1 and mix2 as published, after the effects.
+    u64 final;
+
+    static FrameHashes Of(const SharedMemory& region) {
+        FrameHashes ret;
+        for (size_t i = 0; i < AudioCore::num_sources; i++)
+            ret.status[i] = Hash(&region.source_statuses.status[i], sizeof(SourceStatus::Status));
+        ret.auxiliary = Hash(&region.intermediate_mix_samples, sizeof(IntermediateMixSamples));
+        ret.final = Hash(&region.final_samples, sizeof(FinalMixSamples));
+        return ret;
+    }
+
+    bool operator==(const FrameHashes& other) const {
+        return status == other.status && auxiliary == other.auxiliary && final == other.final;
+    }
+};
+
+/// Captures the intermediate results of one region.
+class StageCapture : public EngineProbe {
+public:
+    void Target(const SharedMemory* region) {
+        target = region;
+        has_output.fill(false);
+    }
+
+    void SourceOutput(const SharedMemory& region, size_t source, const StereoFrame16& output) override {
+        if (&region != target)
+            return;
+        has_output[source] = true;
+        outputs[source] = output;
+    }
+
+    void IntermediateMixes(const SharedMemory& region, const std::array<QuadFrame32, 3>& mixes_) override {
+        if (&region == target)
+            mixes = mixes_;
+    }
+
+    std::array<bool, AudioCore::num_sources> has_output{};
+    std::array<StereoFrame16, AudioCore::num_sources> outputs;
+    std::array<QuadFrame32, 3> mixes;
+
+private:
+    const SharedMemory* target = nullptr;
+};
+
+/// One engine variant with its regions, checkpoint and probe.
+struct Side {
+    explicit Side(const Variant& variant_)
+        : variant(variant_), engine(std::make_unique<Engine>([](PAddr address, u32 size) -> const u8* {
+              return address + static_cast<u64>(size) <= sample_memory.size() ? sample_memory.data() + address : nullptr;
+          })) {
+        engine->SetPrecision(variant.precision);
+        engine->SetSilenceThreshold(variant.silence_threshold);
+        engine->SetSkipMuted(variant.skip_muted);
+        if (variant.batched)
+            engine->SetBatchFrames(0);
+        for (auto& region : regions) {
+            region = std::make_unique<SharedMemory>();
+            std::memset(static_cast<void*>(region.get()), 0, sizeof(SharedMemory));
+        }
+    }
+
+    /// Processes the frames already written to the first `count` regions.
+    void Process(size_t count) {
+        if (variant.batched) {
+            SharedMemory* pointers[chunk_frames];
+            for (size_t i = 0; i < count; i++)
+                pointers[i] = regions[i].get();
+            engine->Render(pointers, count);
+        } else {
+            for (size_t i = 0; i < count; i++)
+                engine->Tick(*regions[i]);
+        }
+    }
+
+    void Save() {
+        engine->SaveState(*checkpoint);
+    }
+
+    void Restore() {
+        engine->LoadState(*checkpoint);
+        for (auto& region : regions)
+            std::memset(static_cast<void*>(region.get()), 0, sizeof(SharedMemory));
+    }
+
+    const Variant& variant;
+    std::unique_ptr<Engine> engine;
+    std::array<std::unique_ptr<SharedMemory>, chunk_frames> regions;
+    std::unique_ptr<EngineState> checkpoint = std::make_unique<EngineState>();
+    StageCapture capture;
+};
+
+/// Runs `frames` frames on the sides given, chunk by chunk. `on_chunk` sees each chunk once it is
+/// processed, and stops the run by returning false.
+template <typename OnChunk>
+void Run(Script& script, std::vector<Side*> sides, size_t first, size_t frames, OnChunk&& on_chunk) {
+    for (size_t start = first; start < frames; start += chunk_frames) {
+        const size_t count = std::min(chunk_frames, frames - start);
+        for (size_t i = 0; i < count; i++) {
+            Script writer = script;
+            for (Side* side : sides) {
+                writer = script;
+                writer.Write(*side->regions[i], start + i);
+            }
+            script = writer;
+        }
+        for (Side* side : sides)
+            side->Process(count);
+        if (!on_chunk(start, count))
+            return;
+    }
+}
+
+/// Runs from chunk-aligned frame `first` through `frame`, capturing the stages of `frame`. Returns
+/// the slot of the region that holds it.
+size_t Replay(Script& script, std::vector<Side*> sides, size_t first, size_t frame) {
+    const size_t slot = (frame - first) % chunk_frames;
+    Run(script, sides, first, frame - slot, [](size_t, size_t) { return true; });
+    for (Side* side : sides) {
+        side->capture.Target(side->regions[slot].get());
+        side->engine->SetProbe(&side->capture);
+    }
+    Run(script, sides, frame - slot, frame + 1, [](size_t, size_t) { return true; });
+    return slot;
+}
+
+void PrintStatusDifference(size_t source, const SourceStatus::Status& a, const SourceStatus::Status& b) {
+    printf("  stage: status of source %zu\n", source);
+    printf("    is_enabled %u / %u, current_buffer_id %u / %u (dirty %u / %u), buffer_position %u / %u, sync %u / %u\n",
+           static_cast<unsigned>(a.is_enabled), static_cast<unsigned>(b.is_enabled), static_cast<unsigned>(a.current_buffer_id),
+           static_cast<unsigned>(b.current_buffer_id), static_cast<unsigned>(a.current_buffer_id_dirty),
+           static_cast<unsigned>(b.current_buffer_id_dirty), static_cast<u32>(a.buffer_position), static_cast<u32>(b.buffer_position),
+           static_cast<unsigned>(a.sync), static_cast<unsigned>(b.sync));
+}
+
+/// Finds the first differing sample of two equally sized arrays. Returns false if they match.
+template <typename T>
+bool FirstDifference(const T* a, const T* b, size_t count, size_t& index) {
+    for (index = 0; index < count; index++) {
+        if (a[index] != b[index])
+            return true;
+    }
+    return false;
+}
+
+/// Compares the captured stages of one frame in pipeline order and reports the first difference.
+void ReportStages(const Side& a, const Side& b, const SharedMemory& region_a, const SharedMemory& region_b) {
+    size_t index;
+    for (size_t i = 0; i < AudioCore::num_sources; i++) {
+        if (a.capture.has_output[i] != b.capture.has_output[i]) {
+            printf("  stage: source %zu produced output in %s only\n", i, a.capture.has_output[i] ? a.variant.name : b.variant.name);
+            return;
+        }
+        if (!a.capture.has_output[i])
+            continue;
+        for (size_t ch = 0; ch < 2; ch++) {
+            if (FirstDifference(a.capture.outputs[i][ch].data(), b.capture.outputs[i][ch].data(), AudioCore::samples_per_frame, index)) {
+                printf("  stage: output of source %zu (decode, resample, filter)\n", i);
+                printf("    channel %zu, sample %zu: %d / %d\n", ch, index, a.capture.outputs[i][ch][index], b.capture.outputs[i][ch][index]);
+                return;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < AudioCore::num_sources; i++) {
+        const auto& status_a = region_a.source_statuses.status[i];
+        const auto& status_b = region_b.source_statuses.status[i];
+        if (std::memcmp(&status_a, &status_b, sizeof(status_a)) != 0) {
+            PrintStatusDifference(i, status_a, status_b);
+            return;
+        }
+    }
+
+    for (size_t mixer = 0; mixer < 3; mixer++) {
+        for (size_t ch = 0; ch < 4; ch++) {
+            if (FirstDifference(a.capture.mixes[mixer][ch].data(), b.capture.mixes[mixer][ch].data(), AudioCore::samples_per_frame, index)) {
+                printf("  stage: intermediate mix %zu (source gains), every source output matching\n", mixer);
+                printf("    channel %zu, sample %zu: %d / %d\n", ch, index, a.capture.mixes[mixer][ch][index], b.capture.mixes[mixer][ch][index]);
+                return;
+            }
+        }
+    }
+
+    const auto& aux_a = region_a.intermediate_mix_samples;
+    const auto& aux_b = region_b.intermediate_mix_samples;
+    const s32* mix_a[2] = {&aux_a.mix1.pcm32[0][0], &aux_a.mix2.pcm32[0][0]};
+    const s32* mix_b[2] = {&aux_b.mix1.pcm32[0][0], &aux_b.mix2.pcm32[0][0]};
+    for (size_t mixer = 0; mixer < 2; mixer++) {
+        if (FirstDifference(mix_a[mixer], mix_b[mixer], 4 * AudioCore::samples_per_frame, index)) {
+            printf("  stage: effect of auxiliary mix %zu\n", mixer + 1);
+            printf("    channel %zu, sample %zu: %d / %d\n", index / AudioCore::samples_per_frame,
+                   index % AudioCore::samples_per_frame, mix_a[mixer][index], mix_b[mixer][index]);
+            return;
+        }
+    }
+
+    if (FirstDifference(region_a.final_samples.pcm16, region_b.final_samples.pcm16, 2 * AudioCore::samples_per_frame, index)) {
+        printf("  stage: final mix (volume, downmix, limiter)\n");
+        printf("    channel %zu, sample %zu: %d / %d\n", index % 2, index / 2, region_a.final_samples.pcm16[index],
+               region_b.final_samples.pcm16[index]);
+        return;
+    }
+
+    printf("  no stage differs on replay: the divergence depends on state before the checkpoint\n");
+}
+
+int Compare(const Variant& variant_a, const Variant& variant_b, u64 seed, size_t frames) {
+    printf("comparing %s (%s) with %s (%s), %zu frames, seed %" PRIu64 "\n", variant_a.name, variant_a.description,
+           variant_b.name, variant_b.description, frames, seed);
+
+    Side a(variant_a), b(variant_b);
+    Script script(seed);
+    Script checkpoint_script = script;
+    size_t checkpoint_frame = 0;
+    a.Save();
+    b.Save();
+
+    size_t diverged = frames;
+    const auto start = std::chrono::steady_clock::now();
+    Run(script, {&a, &b}, 0, frames, [&](size_t first, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (!(FrameHashes::Of(*a.regions[i]) == FrameHashes::Of(*b.regions[i]))) {
+                diverged = first + i;
+                return false;
+            }
+        }
+        if ((first + count) % checkpoint_interval == 0) {
+            a.Save();
+            b.Save();
+            checkpoint_script = script;
+            checkpoint_frame = first + count;
+        }
+        return true;
+    });
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (diverged == frames) {
+        printf("identical over %zu frames (%.0f frames/s per variant)\n", frames, static_cast<double>(frames) / elapsed);
+        return 0;
+    }
+
+    printf("first divergence at frame %zu; replaying from the checkpoint at frame %zu\n", diverged, checkpoint_frame);
+
+    // Rewind both sides and replay up to the divergent frame, capturing its stages.
+    a.Restore();
+    b.Restore();
+    script = checkpoint_script;
+    const size_t slot = Replay(script, {&a, &b}, checkpoint_frame, diverged);
+
+    printf("frame %zu (%s / %s):\n", diverged, variant_a.name, variant_b.name);
+    ReportStages(a, b, *a.regions[slot], *b.regions[slot]);
+    return 1;
+}
+
+int WriteHashes(const Variant& variant, u64 seed, size_t frames, const char* path) {
+    FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        printf("cannot open %s\n", path);
+        return 2;
+    }
+    Side side(variant);
+    Script script(seed);
+    Run(script, {&side}, 0, frames, [&](size_t, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const FrameHashes hashes = FrameHashes::Of(*side.regions[i]);
+            std::fwrite(&hashes, sizeof(hashes), 1, file);
+        }
+        return true;
+    });
+    std::fclose(file);
+    printf("wrote hashes of %zu frames of %s to %s\n", frames, variant.name, path);
+    return 0;
+}
+
+int CheckHashes(const Variant& variant, u64 seed, size_t frames, const char* path) {
+    FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        printf("cannot open %s\n", path);
+        return 2;
+    }
+    Side side(variant);
+    Script script(seed);
+    int result = 0;
+    size_t checked = 0;
+    Run(script, {&side}, 0, frames, [&](size_t first, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            FrameHashes expected;
+            if (std::fread(&expected, sizeof(expected), 1, file) != 1)
+                return false;
+            checked++;
+            const FrameHashes actual = FrameHashes::Of(*side.regions[i]);
+            if (actual == expected)
+                continue;
+
+            printf("first divergence at frame %zu:", first + i);
+            for (size_t s = 0; s < AudioCore::num_sources; s++) {
+                if (actual.status[s] != expected.status[s])
+                    printf(" status of source %zu,", s);
+            }
+            printf("%s%s\n", actual.auxiliary != expected.auxiliary ? " auxiliary mixes," : "",
+                   actual.final != expected.final ? " final mix" : "");
+            printf("run both builds with -x %zu and diff the output to find the stage\n", first + i);
+            result = 1;
+            return false;
+        }
+        return true;
+    });
+    std::fclose(file);
+    if (result == 0)
+        printf("%s matches %s over %zu frames\n", variant.name, path, checked);
+    return result;
+}
+
+/// Prints a hash of every stage of one frame, for diffing between builds.
+int DumpStages(const Variant& variant, u64 seed, size_t frame) {
+    Side side(variant);
+    Script script(seed);
+    const SharedMemory& region = *side.regions[Replay(script, {&side}, 0, frame)];
+
+    printf("frame %zu of %s, seed %" PRIu64 "\n", frame, variant.name, seed);
+    for (size_t i = 0; i < AudioCore::num_sources; i++) {
+        if (side.capture.has_output[i])
+            printf("source %2zu output %016" PRIx64 "\n", i, Hash(&side.capture.outputs[i], sizeof(StereoFrame16)));
+        else
+            printf("source %2zu output none\n", i);
+    }
+    for (size_t i = 0; i < AudioCore::num_sources; i++)
+        printf("source %2zu status %016" PRIx64 "\n", i, Hash(&region.source_statuses.status[i], sizeof(SourceStatus::Status)));
+    for (size_t mixer = 0; mixer < 3; mixer++)
+        printf("intermediate mix %zu %016" PRIx64 "\n", mixer, Hash(&side.capture.mixes[mixer], sizeof(QuadFrame32)));
+    printf("auxiliary mix 1 %016" PRIx64 "\n", Hash(&region.intermediate_mix_samples.mix1, sizeof(IntermediateMixSamples::Samples)));
+    printf("auxiliary mix 2 %016" PRIx64 "\n", Hash(&region.intermediate_mix_samples.mix2, sizeof(IntermediateMixSamples::Samples)));
+    printf("final mix %016" PRIx64 "\n", Hash(&region.final_samples, sizeof(FinalMixSamples)));
+    return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    const Variant* a = &variants[0];
+    const Variant* b = &variants[1];
+    size_t frames = 20000;
+    u64 seed = 1;
+    const char* write_path = nullptr;
+    const char* check_path = nullptr;
+    long dump_frame = -1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* value = argv[i + 1];
+        if (std::strcmp(argv[i], "-a") == 0 || std::strcmp(argv[i], "-b") == 0) {
+            const Variant* variant = FindVariant(value);
+            if (!variant) {
+                printf("unknown variant %s; variants are:\n", value);
+                for (const Variant& v : variants)
+                    printf("  %-8s %s\n", v.name, v.description);
+                return 2;
+            }
+            (argv[i][1] == 'a' ? a : b) = variant;
+        } else if (std::strcmp(argv[i], "-n") == 0) {
+            frames = std::strtoul(value, nullptr, 0);
+        } else if (std::strcmp(argv[i], "-S") == 0) {
+            seed = std::strtoull(value, nullptr, 0);
+        } else if (std::strcmp(argv[i], "-w") == 0) {
+            write_path = value;
+        } else if (std::strcmp(argv[i], "-c") == 0) {
+            check_path = value;
+        } else if (std::strcmp(argv[i], "-x") == 0) {
+            dump_frame = std::strtol(value, nullptr, 0);
+        }
+    }
+
+    if (write_path)
+        return WriteHashes(*a, seed, frames, write_path);
+    if (check_path)
+        return CheckHashes(*a, seed, frames, check_path);
+    if (dump_frame >= 0)
+        return DumpStages(*a, seed, static_cast<size_t>(dump_frame));
+    return Compare(*a, *b, seed, frames);
+}
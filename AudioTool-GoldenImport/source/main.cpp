@@ -0,0 +1,462 @@
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "golden_store.h"
+
+// Imports hardware logs into a golden store (see golden_store.h).
+//
+// Understands the output of three hardware tests, recognised line by line:
+//   AudioTest-InterpLinear-ToFile   "rate_multiplier = %f" followed by a block of "[%03i] = %04hx"
+//   AudioTest-InterpPolyphase-Impulse  "coefficients = %u", "rate_multiplier = %f", then
+//                                   "[intermediate] frame=%i, sample=%i" and a line of %08lx values
+//   AudioTest-FrameDelay            "[intermediate] ..." with %08lx values and "[final] ..." with %04x
+// A log of the console output of the last two works as is; lines the importer does not recognise
+// are ignored. Dump lines wrapped by the console are joined back together.
+//
+// Captures of the same test and parameters from several logs must agree.
+//
+// -c checks the engine against a store: given logs of the same tests run on the engine (see
+// `make golden` in AudioTool-HostCtru), it compares every stored capture with the rendered one and
+// fails if any differs or was not rendered.
+//
+//     AudioTool-GoldenImport -o golden.bin <log>...
+//     AudioTool-GoldenImport -c golden.bin <log>...
+//     AudioTool-GoldenImport -l golden.bin
+//     AudioTool-GoldenImport -q golden.bin linear <rate_multiplier>
+//     AudioTool-GoldenImport -q golden.bin polyphase <coefficients> <rate_multiplier>
+//     AudioTool-GoldenImport -q golden.bin (delay-intermediate | delay-final) <frame>
+
+using namespace DSP::HLE;
+
+namespace {
+
+struct Capture {
+    GoldenEntry entry{};
+    std::vector<s32> values;
+    std::string origin; ///< file:line, for error messages.
+};
+
+const char* TestName(GoldenTest test) {
+    switch (test) {
+    case GoldenTest::InterpLinear:
+        return "linear";
+    case GoldenTest::PolyphaseImpulse:
+        return "polyphase";
+    case GoldenTest::FrameDelayIntermediate:
+        return "delay-intermediate";
+    case GoldenTest::FrameDelayFinal:
+        return "delay-final";
+    default:
+        return "none";
+    }
+}
+
+/// Parses "%f" as printed by the tests into the key's millionths.
+u32 ParseRate(const char* text) {
+    return static_cast<u32>(std::strtod(text, nullptr) * 1e6 + 0.5);
+}
+
+/// Whether `line` holds nothing but hex digits and spaces, as a (possibly wrapped) dump line does.
+bool IsHexDumpLine(const std::string& line) {
+    bool any = false;
+    for (char c : line) {
+        if (std::isxdigit(static_cast<unsigned char>(c)))
+            any = true;
+        else if (c != ' ')
+            return false;
+    }
+    return any;
+}
+
+/// Splits a dump of fixed-width hex numbers into values. The width, not the spacing, delimits the
+/// numbers, since the console may wrap a line in the middle of one. Returns false if the digits do
+/// not divide evenly.
+bool ParseHexDump(const std::string& dump, unsigned digits, std::vector<s32>& values) {
+    std::string packed;
+    for (char c : dump) {
+        if (c != ' ')
+            packed.push_back(c);
+    }
+    if (packed.size() % digits != 0)
+        return false;
+    for (size_t i = 0; i < packed.size(); i += digits) {
+        const u32 raw = static_cast<u32>(std::strtoul(packed.substr(i, digits).c_str(), nullptr, 16));
+        values.push_back(digits == 4 ? static_cast<s16>(raw) : static_cast<s32>(raw));
+    }
+    return true;
+}
+
+u16 FirstNonZero(const std::vector<s32>& values) {
+    for (size_t i = 0; i < values.size(); i++) {
+        if (values[i] != 0)
+            return static_cast<u16>(i);
+    }
+    return 0;
+}
+
+class LogParser {
+public:
+    LogParser(const char* path_, std::vector<Capture>& captures_) : path(path_), captures(captures_) {}
+
+    bool Parse() {
+        FILE* file = std::fopen(path, "r");
+        if (!file) {
+            printf("cannot open %s\n", path);
+            return false;
+        }
+        char buffer[4096];
+        while (std::fgets(buffer, sizeof(buffer), file)) {
+            line_number++;
+            std::string line(buffer);
+            while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+                line.pop_back();
+            Line(line);
+        }
+        Flush();
+        std::fclose(file);
+        return true;
+    }
+
+private:
+    void Line(const std::string& line) {
+        if (pending.entry.key.test != GoldenTest::None && !linear_block && IsHexDumpLine(line)) {
+            dump += line;
+            return;
+        }
+
+        int index;
+        unsigned value;
+        char tail;
+        if (std::sscanf(line.c_str(), "[%d] = %x%c", &index, &value, &tail) == 2) {
+            if (!linear_block) {
+                Flush();
+                if (!has_rate) {
+                    printf("%s:%zu: samples without a rate_multiplier header\n", path, line_number);
+                    return;
+                }
+                Begin(GoldenKey{GoldenTest::InterpLinear, {rate, 0}}, golden_frame_not_logged, 16);
+                linear_block = true;
+            }
+            if (index != static_cast<int>(pending.values.size()))
+                printf("%s:%zu: expected sample %zu, found %d\n", path, line_number, pending.values.size(), index);
+            pending.values.push_back(static_cast<s16>(value));
+            return;
+        }
+
+        Flush();
+
+        const char* equals = std::strstr(line.c_str(), "rate_multiplier = ");
+        if (equals) {
+            rate = ParseRate(equals + std::strlen("rate_multiplier = "));
+            has_rate = true;
+            return;
+        }
+
+        if (std::sscanf(line.c_str(), "coefficients = %u", &value) == 1) {
+            coefficients = value;
+            has_coefficients = true;
+            return;
+        }
+
+        unsigned frame, first;
+        if (std::sscanf(line.c_str(), "[intermediate] frame=%u, sample=%u", &frame, &first) == 2) {
+            if (has_coefficients)
+                Begin(GoldenKey{GoldenTest::PolyphaseImpulse, {coefficients, has_rate ? rate : 0}}, frame, 32);
+            else
+                Begin(GoldenKey::FrameDelayIntermediate(frame), frame, 32);
+            pending.entry.first_sample = static_cast<u16>(first);
+            return;
+        }
+        if (std::sscanf(line.c_str(), "[final] frame=%u, sample=%u", &frame, &first) == 2) {
+            Begin(GoldenKey::FrameDelayFinal(frame), frame, 16);
+            pending.entry.first_sample = static_cast<u16>(first);
+            return;
+        }
+    }
+
+    void Begin(const GoldenKey& key, u32 frame, u16 bits) {
+        pending = Capture{};
+        pending.entry.key = key;
+        pending.entry.frame = frame;
+        pending.entry.bits = bits;
+        pending.origin = std::string(path) + ":" + std::to_string(line_number);
+    }
+
+    void Flush() {
+        if (pending.entry.key.test != GoldenTest::None) {
+            if (!linear_block && !ParseHexDump(dump, pending.entry.bits == 16 ? 4 : 8, pending.values)) {
+                printf("%s: truncated dump\n", pending.origin.c_str());
+            } else if (pending.values.empty()) {
+                printf("%s: no samples follow\n", pending.origin.c_str());
+            } else {
+                if (linear_block)
+                    pending.entry.first_sample = FirstNonZero(pending.values);
+                pending.entry.count = static_cast<u32>(pending.values.size());
+                captures.push_back(std::move(pending));
+            }
+        }
+        pending = Capture{};
+        dump.clear();
+        linear_block = false;
+    }
+
+    const char* path;
+    std::vector<Capture>& captures;
+    size_t line_number = 0;
+
+    u32 rate = 0;
+    bool has_rate = false;
+    unsigned coefficients = 0;
+    bool has_coefficients = false;
+
+    Capture pending;
+    std::string dump; ///< Lines of the pending hex dump.
+    bool linear_block = false;
+};
+
+/// Drops repeated captures and fails on conflicting ones.
+bool Deduplicate(std::vector<Capture>& captures) {
+    std::vector<Capture> unique;
+    bool ok = true;
+    for (Capture& capture : captures) {
+        bool seen = false;
+        for (const Capture& kept : unique) {
+            if (!(kept.entry.key == capture.entry.key))
+                continue;
+            seen = true;
+            if (kept.values != capture.values) {
+                printf("%s conflicts with the capture at %s\n", capture.origin.c_str(), kept.origin.c_str());
+                ok = false;
+            }
+            break;
+        }
+        if (!seen)
+            unique.push_back(std::move(capture));
+    }
+    captures = std::move(unique);
+    return ok;
+}
+
+bool WriteStore(const char* path, std::vector<Capture>& captures) {
+    u32 slot_count = 2;
+    while (slot_count < captures.size() * 2)
+        slot_count *= 2;
+
+    std::vector<GoldenEntry> slots(slot_count);
+    std::vector<s32> values;
+    for (Capture& capture : captures) {
+        capture.entry.offset = static_cast<u32>(values.size());
+        values.insert(values.end(), capture.values.begin(), capture.values.end());
+        u32 slot = static_cast<u32>(capture.entry.key.Hash()) & (slot_count - 1);
+        while (slots[slot].key.test != GoldenTest::None)
+            slot = (slot + 1) & (slot_count - 1);
+        slots[slot] = capture.entry;
+    }
+
+    GoldenHeader header;
+    std::memcpy(header.magic, golden_magic, sizeof(golden_magic));
+    header.version = golden_version;
+    header.slot_count = slot_count;
+    header.entry_count = static_cast<u32>(captures.size());
+    header.value_count = static_cast<u32>(values.size());
+
+    FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        printf("cannot open %s\n", path);
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok &= std::fwrite(slots.data(), sizeof(GoldenEntry), slots.size(), file) == slots.size();
+    ok &= std::fwrite(values.data(), sizeof(s32), values.size(), file) == values.size();
+    ok &= std::fclose(file) == 0;
+    if (!ok)
+        printf("cannot write %s\n", path);
+    return ok;
+}
+
+/// Reads a whole store. The s32 vector keeps the entries and values aligned.
+bool ReadStore(const char* path, std::vector<s32>& data, GoldenStore& store) {
+    FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        printf("cannot open %s\n", path);
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    data.resize((static_cast<size_t>(size) + sizeof(s32) - 1) / sizeof(s32));
+    const size_t read = std::fread(data.data(), 1, static_cast<size_t>(size), file);
+    std::fclose(file);
+
+    store = GoldenStore(data.data(), read);
+    if (!store.IsValid()) {
+        printf("%s is not a golden store\n", path);
+        return false;
+    }
+    return true;
+}
+
+void PrintParams(const GoldenKey& key) {
+    switch (key.test) {
+    case GoldenTest::InterpLinear:
+        printf(" rate_multiplier=%.6f", key.params[0] / 1e6);
+        break;
+    case GoldenTest::PolyphaseImpulse:
+        printf(" coefficients=%u rate_multiplier=%.6f", key.params[0], key.params[1] / 1e6);
+        break;
+    case GoldenTest::FrameDelayIntermediate:
+    case GoldenTest::FrameDelayFinal:
+        printf(" frame=%u", key.params[0]);
+        break;
+    default:
+        break;
+    }
+}
+
+void PrintEntry(const GoldenEntry& entry) {
+    printf("%-18s", TestName(entry.key.test));
+    PrintParams(entry.key);
+    printf(" values=%u bits=%u", entry.count, entry.bits);
+    printf(" first_nonzero=%u\n", entry.first_sample);
+}
+
+int Import(const char* out_path, char** logs, int log_count) {
+    std::vector<Capture> captures;
+    for (int i = 0; i < log_count; i++) {
+        if (!LogParser(logs[i], captures).Parse())
+            return 2;
+    }
+    if (!Deduplicate(captures))
+        return 1;
+    if (captures.empty()) {
+        printf("no captures found\n");
+        return 1;
+    }
+    if (!WriteStore(out_path, captures))
+        return 2;
+    for (const Capture& capture : captures)
+        PrintEntry(capture.entry);
+    printf("wrote %zu captures to %s\n", captures.size(), out_path);
+    return 0;
+}
+
+int Check(const char* store_path, char** logs, int log_count) {
+    std::vector<s32> data;
+    GoldenStore store;
+    if (!ReadStore(store_path, data, store))
+        return 2;
+    std::vector<Capture> rendered;
+    for (int i = 0; i < log_count; i++) {
+        if (!LogParser(logs[i], rendered).Parse())
+            return 2;
+    }
+    if (!Deduplicate(rendered))
+        return 2;
+
+    size_t matched = 0, failed = 0;
+    store.ForEach([&](const GoldenEntry& entry) {
+        const auto capture = std::find_if(rendered.begin(), rendered.end(),
+                                          [&](const Capture& c) { return c.entry.key == entry.key; });
+        if (capture == rendered.end()) {
+            printf("not rendered %-18s", TestName(entry.key.test));
+            PrintParams(entry.key);
+            printf("\n");
+            failed++;
+            return;
+        }
+
+        const s32* expected = store.Values(entry);
+        const std::vector<s32>& actual = capture->values;
+        u32 first_difference = entry.count;
+        for (u32 i = 0; i < entry.count && first_difference == entry.count; i++) {
+            if (i >= actual.size() || actual[i] != expected[i])
+                first_difference = i;
+        }
+        if (first_difference == entry.count && actual.size() == entry.count) {
+            matched++;
+            return;
+        }
+
+        printf("differs      %-18s", TestName(entry.key.test));
+        PrintParams(entry.key);
+        if (first_difference < entry.count && first_difference < actual.size())
+            printf(": value %u is %d, hardware %d (%s)\n", first_difference, actual[first_difference],
+                   expected[first_difference], capture->origin.c_str());
+        else
+            printf(": %zu values, hardware %u (%s)\n", actual.size(), entry.count, capture->origin.c_str());
+        failed++;
+    });
+
+    printf("%zu of %zu captures match\n", matched, matched + failed);
+    return failed == 0 ? 0 : 1;
+}
+
+int List(const char* path) {
+    std::vector<s32> data;
+    GoldenStore store;
+    if (!ReadStore(path, data, store))
+        return 2;
+    store.ForEach(PrintEntry);
+    printf("%zu captures\n", store.EntryCount());
+    return 0;
+}
+
+int Query(const char* path, char** args, int arg_count) {
+    GoldenKey key;
+    if (arg_count == 2 && std::strcmp(args[0], "linear") == 0) {
+        key = GoldenKey::InterpLinear(std::strtof(args[1], nullptr));
+    } else if (arg_count == 3 && std::strcmp(args[0], "polyphase") == 0) {
+        key = GoldenKey::PolyphaseImpulse(std::strtoul(args[1], nullptr, 0), std::strtof(args[2], nullptr));
+    } else if (arg_count == 2 && std::strcmp(args[0], "delay-intermediate") == 0) {
+        key = GoldenKey::FrameDelayIntermediate(std::strtoul(args[1], nullptr, 0));
+    } else if (arg_count == 2 && std::strcmp(args[0], "delay-final") == 0) {
+        key = GoldenKey::FrameDelayFinal(std::strtoul(args[1], nullptr, 0));
+    } else {
+        printf("unknown query\n");
+        return 2;
+    }
+
+    std::vector<s32> data;
+    GoldenStore store;
+    if (!ReadStore(path, data, store))
+        return 2;
+    const GoldenEntry* entry = store.Find(key);
+    if (!entry) {
+        printf("no capture for %s", TestName(key.test));
+        PrintParams(key);
+        printf("\n");
+        return 1;
+    }
+    PrintEntry(*entry);
+    const s32* values = store.Values(*entry);
+    for (u32 i = 0; i < entry->count; i++)
+        printf("[%03u] = %d\n", i, values[i]);
+    return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && std::strcmp(argv[1], "-o") == 0)
+        return Import(argv[2], argv + 3, argc - 3);
+    if (argc >= 4 && std::strcmp(argv[1], "-c") == 0)
+        return Check(argv[2], argv + 3, argc - 3);
+    if (argc == 3 && std::strcmp(argv[1], "-l") == 0)
+        return List(argv[2]);
+    if (argc >= 4 && std::strcmp(argv[1], "-q") == 0)
+        return Query(argv[2], argv + 3, argc - 3);
+
+    printf("usage: %s -o <store> <log>...\n", argv[0]);
+    printf("       %s -c <store> <log>...\n", argv[0]);
+    printf("       %s -l <store>\n", argv[0]);
+    printf("       %s -q <store> linear <rate_multiplier>\n", argv[0]);
+    printf("       %s -q <store> polyphase <coefficients> <rate_multiplier>\n", argv[0]);
+    printf("       %s -q <store> (delay-intermediate | delay-final) <frame>\n", argv[0]);
+    return 2;
+}
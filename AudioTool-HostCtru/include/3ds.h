@@ -0,0 +1,124 @@
+#pragma once
+
+// Host stand-in for the parts of libctru that audio.cpp and the AudioTest programs use.
+//
+// The DSP service is backed by DSP::HLE::Engine running on its own thread, the kernel objects by
+// host threads, and the linear heap by a host arena with 3DS-like physical addresses. The screens
+// and buttons are headless: console output goes to stdout, and each hidScanInput takes the next
+// press from the HOSTCTRU_KEYS environment variable (e.g. "B,A"), pressing A once it runs out.
+//
+// HOSTCTRU_DSP_CLOCK picks how the DSP keeps time: "free" processes each frame as soon as it is
+// signalled, "realtime" processes one frame per hardware period (160 samples at 32728 Hz), and
+// "simulated" does the same in simulated time, which passes only in svcSleepThread and while
+// waiting. In the timed modes a period with no frame signalled is dropped and counted in
+// DspStatus::dropped_frames; in simulated time the count depends only on the sleeps.
+
+#include <cstddef>
+#include <cstdint>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef volatile u8 vu8;
+typedef volatile u16 vu16;
+typedef volatile u32 vu32;
+typedef volatile u64 vu64;
+
+typedef u32 Handle;
+typedef s32 Result;
+
+#define R_SUCCEEDED(res) ((res) >= 0)
+#define R_FAILED(res) ((res) < 0)
+
+#define U64_MAX UINT64_MAX
+
+/// Returned by svcWaitSynchronization when the timeout expires.
+#define RES_TIMEOUT ((Result)0x09401BFE)
+/// Returned for handles that do not exist.
+#define RES_INVALID_HANDLE ((Result)0xD8E007F7)
+
+#define SYSCLOCK_ARM11 268111856
+
+// Kernel
+
+typedef enum {
+    RESET_ONESHOT = 0,
+    RESET_STICKY = 1,
+    RESET_PULSE = 2,
+} ResetType;
+
+Result svcCreateEvent(Handle* event, ResetType reset_type);
+Result svcSignalEvent(Handle handle);
+Result svcClearEvent(Handle handle);
+Result svcWaitSynchronization(Handle handle, s64 nanoseconds);
+Result svcCloseHandle(Handle handle);
+u64 svcGetSystemTick();
+void svcSleepThread(s64 nanoseconds);
+
+// Memory
+
+void* linearAlloc(size_t size);
+void linearFree(void* mem);
+u32 osConvertVirtToPhys(const void* vaddr);
+
+// DSP service
+
+Result dspInit();
+void dspExit();
+Result DSP_LoadComponent(const void* component, u32 size, u16 prog_mask, u16 data_mask, bool* is_loaded);
+Result DSP_UnloadComponent();
+Result DSP_RegisterInterruptEvents(Handle handle, u32 interrupt, u32 channel);
+Result DSP_GetSemaphoreHandle(Handle* semaphore);
+Result DSP_SetSemaphore(u16 value);
+Result DSP_SetSemaphoreMask(u16 mask);
+Result DSP_WriteProcessPipe(u32 channel, const void* buffer, u32 length);
+Result DSP_ReadPipeIfPossible(u32 channel, u32 peer, void* buffer, u16 length, u16* length_read);
+Result DSP_ConvertProcessAddressFromDspDram(u32 dsp_address, u32* arm_address);
+Result DSP_FlushDataCache(const void* address, u32 size);
+Result DSP_InvalidateDataCache(const void* address, u32 size);
+
+// Screens, buttons and applet
+
+typedef enum {
+    GFX_TOP = 0,
+    GFX_BOTTOM = 1,
+} gfxScreen_t;
+
+typedef struct PrintConsole {
+    int screen;
+} PrintConsole;
+
+void gfxInitDefault();
+void gfxExit();
+void gfxSwapBuffers();
+void gfxFlushBuffers();
+void gspWaitForVBlank();
+PrintConsole* consoleInit(gfxScreen_t screen, PrintConsole* console);
+PrintConsole* consoleSelect(PrintConsole* console);
+
+enum {
+    KEY_A = 1 << 0,
+    KEY_B = 1 << 1,
+    KEY_SELECT = 1 << 2,
+    KEY_START = 1 << 3,
+    KEY_DRIGHT = 1 << 4,
+    KEY_DLEFT = 1 << 5,
+    KEY_DUP = 1 << 6,
+    KEY_DDOWN = 1 << 7,
+    KEY_R = 1 << 8,
+    KEY_L = 1 << 9,
+    KEY_X = 1 << 10,
+    KEY_Y = 1 << 11,
+};
+
+void hidScanInput();
+u32 hidKeysDown();
+u32 hidKeysHeld();
+
+bool aptMainLoop();
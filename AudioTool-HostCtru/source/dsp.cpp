@@ -0,0 +1,443 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "dsp.h"
+#include "engine.h"
+#include "host_ctru.h"
+
+// The DSP service, backed by a software DSP: DSP::HLE::Engine on its own thread.
+//
+// The firmware is accepted but never looked at. The application talks to the software DSP exactly
+// as it would to the real one: a mode 0 command on pipe 2 makes it answer with the addresses of
+// its 15 shared structures, and each signal of the semaphore event processes one frame and
+// raises the pipe 2 interrupt.
+//
+// The application's frame is taken in when it signals. With the free-running clock it is processed
+// straight away; with the timed clocks it waits for the next period of the DSP's clock, and a
+// period that finds no frame waiting counts as dropped.
+//
+// audio.cpp turns the 32-bit addresses DSP_ConvertProcessAddressFromDspDram returns into pointers,
+// so DSP RAM is mapped where the 3DS has it, with the shared page after it (initSharedMem reads
+// headphones_connected there). Both regions are then at region0_base and region1_base.
+
+using namespace DSP::HLE;
+
+namespace {
+
+constexpr u32 dsp_ram_vaddr = 0x1FF00000;
+constexpr u32 dsp_ram_size = 0x80000;
+/// The configuration memory and the shared page that follow DSP RAM.
+constexpr u32 system_pages_size = 0x2000;
+/// Where data memory starts within DSP RAM, as libctru converts addresses.
+constexpr u32 dsp_data_offset = 0x40000;
+
+constexpr u32 interrupt_pipe = 2;
+constexpr u32 audio_pipe = 2;
+
+constexpr u32 dsp_mode_initialize = 0;
+constexpr u32 dsp_mode_shutdown = 1;
+
+/// The word addresses of the 15 structures in region 0, in the order the firmware reports them.
+const std::vector<u16>& StructAddresses() {
+    static const std::vector<u16> addresses = [] {
+        const size_t offsets[] = {
+            offsetof(SharedMemory, frame_counter),
+            offsetof(SharedMemory, source_configurations),
+            offsetof(SharedMemory, source_statuses),
+            offsetof(SharedMemory, adpcm_coefficients),
+            offsetof(SharedMemory, dsp_configuration),
+            offsetof(SharedMemory, dsp_status),
+            offsetof(SharedMemory, final_samples),
+            offsetof(SharedMemory, intermediate_mix_samples),
+            offsetof(SharedMemory, compressor),
+            offsetof(SharedMemory, dsp_debug),
+            offsetof(SharedMemory, unknown10),
+            offsetof(SharedMemory, unknown11),
+            offsetof(SharedMemory, unknown12),
+            offsetof(SharedMemory, unknown13),
+            offsetof(SharedMemory, unknown14),
+        };
+        const u32 region0_word = (region0_base - dsp_ram_vaddr - dsp_data_offset) / 2;
+        std::vector<u16> result;
+        for (size_t offset : offsets)
+            result.push_back(static_cast<u16>(region0_word + offset / 2));
+        return result;
+    }();
+    return addresses;
+}
+
+/// Maps DSP RAM and the system pages at their 3DS addresses, once per process.
+bool MapDspRam() {
+    static const bool mapped = [] {
+        void* const wanted = reinterpret_cast<void*>(static_cast<uintptr_t>(dsp_ram_vaddr));
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_FIXED_NOREPLACE)
+        flags |= MAP_FIXED_NOREPLACE;
+#endif
+        void* const actual = mmap(wanted, dsp_ram_size + system_pages_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (actual == MAP_FAILED)
+            return false;
+        if (actual != wanted) {
+            munmap(actual, dsp_ram_size + system_pages_size);
+            return false;
+        }
+        return true;
+    }();
+    return mapped;
+}
+
+SharedMemory& Region(size_t index) {
+    return *reinterpret_cast<SharedMemory*>(static_cast<uintptr_t>(index == 0 ? region0_base : region1_base));
+}
+
+/**
+ * Index of the region the application wrote last: the one with the higher frame counter, allowing
+ * for the counters wrapping around. The same rule as the firmware's, as Citra implements it.
+ */
+size_t CurrentRegionIndex() {
+    const u16 counter0 = Region(0).frame_counter;
+    const u16 counter1 = Region(1).frame_counter;
+    if (counter0 == 0xFFFF && counter1 != 0xFFFE)
+        return 1;
+    if (counter1 == 0xFFFF && counter0 != 0xFFFE)
+        return 0;
+    return counter0 > counter1 ? 0 : 1;
+}
+
+template <typename T>
+void CopyBlock(T& to, const T& from) {
+    std::memcpy(static_cast<void*>(&to), static_cast<const void*>(&from), sizeof(T));
+}
+
+/// Length of a frame on the DSP's clock, about 4.89 ms.
+constexpr double frame_period_ns = AudioCore::samples_per_frame * 1e9 / native_sample_rate;
+
+/// A frame's configuration as it stood when the application signalled it.
+struct LatchedFrame {
+    SharedMemory* read; ///< The region it came from.
+    std::unique_ptr<SharedMemory> memory;
+};
+
+class SoftwareDsp {
+public:
+    SoftwareDsp();
+    ~SoftwareDsp();
+
+    Handle Semaphore() const {
+        return semaphore;
+    }
+
+    void RegisterInterrupt(Handle event);
+    void WritePipe(const u8* data, u32 length);
+    u16 ReadPipe(u8* data, u16 length);
+
+    /// Time of the next period of the clock, or U64_MAX while the clock is stopped.
+    u64 NextTick();
+    /// Runs one period of the clock.
+    void Tick();
+
+private:
+    void Run();
+    void HandleCommand(u32 mode);
+    void LatchFrame();
+    void ClockTick(std::unique_lock<std::mutex>& lock);
+    void ProcessFrame(std::unique_lock<std::mutex>& lock);
+    void RaiseInterrupt();
+
+    u64 TickTime(u64 index) const {
+        return clock_start + static_cast<u64>(static_cast<double>(index) * frame_period_ns);
+    }
+
+    const HostCtru::ClockMode clock;
+    Engine engine;
+    Handle semaphore;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    Handle interrupt = 0;
+    bool running = false;
+    bool quit = false;
+    std::vector<u8> pipe_in;
+    std::deque<u8> pipe_out;
+
+    std::deque<LatchedFrame> pending;
+    std::vector<std::unique_ptr<SharedMemory>> spare;
+
+    /// The clock starts with the first frame after initialization.
+    bool clock_started = false;
+    u64 clock_start = 0;
+    u64 ticks = 0;
+    /// Periods that passed with no frame to process, reported in DspStatus::dropped_frames.
+    u16 dropped_frames = 0;
+
+    std::thread thread;
+};
+
+SoftwareDsp::SoftwareDsp() : clock(HostCtru::GetClockMode()), engine([](PAddr address, u32 size) {
+                                 return HostCtru::TranslatePhysical(address, size);
+                             }) {
+    semaphore = HostCtru::CreateEvent(RESET_ONESHOT, [this] { LatchFrame(); });
+    thread = std::thread([this] { Run(); });
+}
+
+SoftwareDsp::~SoftwareDsp() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    thread.join();
+    svcCloseHandle(semaphore);
+}
+
+void SoftwareDsp::RegisterInterrupt(Handle event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    interrupt = event;
+}
+
+void SoftwareDsp::WritePipe(const u8* data, u32 length) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pipe_in.insert(pipe_in.end(), data, data + length);
+    }
+    wake.notify_one();
+}
+
+u16 SoftwareDsp::ReadPipe(u8* data, u16 length) {
+    std::lock_guard<std::mutex> lock(mutex);
+    u16 read = 0;
+    for (; read < length && !pipe_out.empty(); read++) {
+        data[read] = pipe_out.front();
+        pipe_out.pop_front();
+    }
+    return read;
+}
+
+u64 SoftwareDsp::NextTick() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return running && clock_started ? TickTime(ticks) : U64_MAX;
+}
+
+void SoftwareDsp::Tick() {
+    std::unique_lock<std::mutex> lock(mutex);
+    ClockTick(lock);
+}
+
+void SoftwareDsp::Run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!quit) {
+        if (pipe_in.size() >= 4) {
+            u32 mode;
+            std::memcpy(&mode, pipe_in.data(), 4);
+            pipe_in.erase(pipe_in.begin(), pipe_in.begin() + 4);
+            HandleCommand(mode);
+            continue;
+        }
+
+        if (clock == HostCtru::ClockMode::FreeRunning && !pending.empty()) {
+            ProcessFrame(lock);
+            continue;
+        }
+
+        // Simulated time is advanced by the application's thread, which runs the ticks itself.
+        if (clock == HostCtru::ClockMode::RealTime && running && clock_started) {
+            const u64 now = HostCtru::Now();
+            const u64 next = TickTime(ticks);
+            if (now >= next)
+                ClockTick(lock);
+            else
+                wake.wait_for(lock, std::chrono::nanoseconds(next - now));
+            continue;
+        }
+
+        wake.wait(lock);
+    }
+}
+
+void SoftwareDsp::HandleCommand(u32 mode) {
+    switch (mode) {
+    case dsp_mode_initialize: {
+        std::memset(static_cast<void*>(&Region(0)), 0, sizeof(SharedMemory));
+        std::memset(static_cast<void*>(&Region(1)), 0, sizeof(SharedMemory));
+        engine.Reset();
+        pending.clear();
+        clock_started = false;
+        dropped_frames = 0;
+
+        const std::vector<u16>& addresses = StructAddresses();
+        const u16 count = static_cast<u16>(addresses.size());
+        pipe_out.clear();
+        pipe_out.insert(pipe_out.end(), reinterpret_cast<const u8*>(&count), reinterpret_cast<const u8*>(&count) + 2);
+        for (u16 address : addresses)
+            pipe_out.insert(pipe_out.end(), reinterpret_cast<const u8*>(&address), reinterpret_cast<const u8*>(&address) + 2);
+        running = true;
+        RaiseInterrupt();
+        break;
+    }
+    case dsp_mode_shutdown:
+        running = false;
+        break;
+    default:
+        // Sleep and wakeup: there is no state to lose.
+        break;
+    }
+}
+
+void SoftwareDsp::LatchFrame() {
+    // Called on the application's thread when it signals the semaphore. Like the real DSP, take in
+    // the frame before the application can go on to write the next region.
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running)
+        return;
+    if (!clock_started) {
+        clock_started = true;
+        clock_start = HostCtru::Now();
+        ticks = 0;
+    }
+
+    LatchedFrame frame;
+    if (spare.empty()) {
+        frame.memory = std::make_unique<SharedMemory>();
+    } else {
+        frame.memory = std::move(spare.back());
+        spare.pop_back();
+    }
+    // Configuration is read from the region written last and acknowledged there.
+    frame.read = &Region(CurrentRegionIndex());
+    CopyBlock(*frame.memory, *frame.read);
+    pending.push_back(std::move(frame));
+    wake.notify_one();
+}
+
+void SoftwareDsp::ClockTick(std::unique_lock<std::mutex>& lock) {
+    ticks++;
+    if (pending.empty()) {
+        // The application missed the deadline: this period's frame is lost.
+        dropped_frames++;
+        return;
+    }
+    ProcessFrame(lock);
+}
+
+void SoftwareDsp::ProcessFrame(std::unique_lock<std::mutex>& lock) {
+    LatchedFrame frame = std::move(pending.front());
+    pending.pop_front();
+    SharedMemory& scratch = *frame.memory;
+    SharedMemory& read = *frame.read;
+    // Statuses and samples go to the other region, which is the one the application reads next.
+    SharedMemory& write = &read == &Region(0) ? Region(1) : Region(0);
+    scratch.dsp_status.dropped_frames = dropped_frames;
+
+    lock.unlock();
+    engine.Tick(scratch);
+    CopyBlock(read.source_configurations, scratch.source_configurations);
+    CopyBlock(read.dsp_configuration, scratch.dsp_configuration);
+    CopyBlock(write.source_statuses, scratch.source_statuses);
+    CopyBlock(write.dsp_status, scratch.dsp_status);
+    CopyBlock(write.final_samples, scratch.final_samples);
+    CopyBlock(write.intermediate_mix_samples, scratch.intermediate_mix_samples);
+    lock.lock();
+
+    spare.push_back(std::move(frame.memory));
+    RaiseInterrupt();
+}
+
+void SoftwareDsp::RaiseInterrupt() {
+    if (interrupt != 0)
+        svcSignalEvent(interrupt);
+}
+
+std::unique_ptr<SoftwareDsp> dsp;
+bool component_loaded = false;
+
+} // anonymous namespace
+
+Result dspInit() {
+    if (dsp)
+        return 0;
+    if (!MapDspRam())
+        return -1;
+    dsp = std::make_unique<SoftwareDsp>();
+    HostCtru::SetTickSource([] { return dsp->NextTick(); }, [] { dsp->Tick(); });
+    return 0;
+}
+
+void dspExit() {
+    HostCtru::SetTickSource({}, {});
+    dsp.reset();
+    component_loaded = false;
+}
+
+Result DSP_LoadComponent(const void*, u32, u16, u16, bool* is_loaded) {
+    component_loaded = true;
+    *is_loaded = true;
+    return 0;
+}
+
+Result DSP_UnloadComponent() {
+    component_loaded = false;
+    return 0;
+}
+
+Result DSP_RegisterInterruptEvents(Handle handle, u32 interrupt, u32 channel) {
+    if (!dsp)
+        return -1;
+    if (interrupt == interrupt_pipe && channel == audio_pipe)
+        dsp->RegisterInterrupt(handle);
+    return 0;
+}
+
+Result DSP_GetSemaphoreHandle(Handle* semaphore) {
+    if (!dsp)
+        return -1;
+    *semaphore = dsp->Semaphore();
+    return 0;
+}
+
+Result DSP_SetSemaphore(u16) {
+    return dsp ? 0 : -1;
+}
+
+Result DSP_SetSemaphoreMask(u16) {
+    return dsp ? 0 : -1;
+}
+
+Result DSP_WriteProcessPipe(u32 channel, const void* buffer, u32 length) {
+    if (!dsp || !component_loaded)
+        return -1;
+    if (channel == audio_pipe)
+        dsp->WritePipe(static_cast<const u8*>(buffer), length);
+    return 0;
+}
+
+Result DSP_ReadPipeIfPossible(u32 channel, u32, void* buffer, u16 length, u16* length_read) {
+    if (!dsp)
+        return -1;
+    *length_read = channel == audio_pipe ? dsp->ReadPipe(static_cast<u8*>(buffer), length) : 0;
+    return 0;
+}
+
+Result DSP_ConvertProcessAddressFromDspDram(u32 dsp_address, u32* arm_address) {
+    const u32 offset = dsp_data_offset + dsp_address * 2;
+    if (offset >= dsp_ram_size)
+        return -1;
+    *arm_address = dsp_ram_vaddr + offset;
+    return 0;
+}
+
+Result DSP_FlushDataCache(const void*, u32) {
+    return 0;
+}
+
+Result DSP_InvalidateDataCache(const void*, u32) {
+    return 0;
+}
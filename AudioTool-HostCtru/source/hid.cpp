@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+
+#include <3ds.h>
+
+// Headless screens and buttons. Both consoles print to stdout, frames are never paced, and
+// button presses come from HOSTCTRU_KEYS.
+
+namespace {
+
+struct KeyName {
+    const char* name;
+    u32 key;
+};
+
+constexpr KeyName key_names[] = {
+    {"A", KEY_A},         {"B", KEY_B},         {"X", KEY_X},         {"Y", KEY_Y},
+    {"L", KEY_L},         {"R", KEY_R},         {"START", KEY_START}, {"SELECT", KEY_SELECT},
+    {"UP", KEY_DUP},      {"DOWN", KEY_DDOWN},  {"LEFT", KEY_DLEFT},  {"RIGHT", KEY_DRIGHT},
+};
+
+std::deque<u32> pending_keys;
+bool keys_parsed = false;
+u32 keys_down = 0;
+
+/// Reads HOSTCTRU_KEYS, a comma-separated list of presses such as "B,A", one per scan.
+void ParseKeys() {
+    keys_parsed = true;
+    const char* const value = std::getenv("HOSTCTRU_KEYS");
+    if (!value)
+        return;
+
+    std::string list = value;
+    size_t start = 0;
+    while (start <= list.size()) {
+        const size_t end = std::min(list.find(',', start), list.size());
+        const std::string name = list.substr(start, end - start);
+        start = end + 1;
+        if (name.empty())
+            continue;
+
+        u32 key = 0;
+        for (const KeyName& entry : key_names) {
+            if (name == entry.name)
+                key = entry.key;
+        }
+        if (key == 0)
+            std::fprintf(stderr, "HOSTCTRU_KEYS: unknown key %s\n", name.c_str());
+        else
+            pending_keys.push_back(key);
+    }
+}
+
+} // anonymous namespace
+
+void gfxInitDefault() {}
+
+void gfxExit() {
+    std::fflush(stdout);
+}
+
+void gfxSwapBuffers() {}
+
+void gfxFlushBuffers() {}
+
+void gspWaitForVBlank() {}
+
+PrintConsole* consoleInit(gfxScreen_t screen, PrintConsole* console) {
+    static PrintConsole default_console;
+    if (!console)
+        console = &default_console;
+    console->screen = screen;
+    return console;
+}
+
+PrintConsole* consoleSelect(PrintConsole* console) {
+    return console;
+}
+
+void hidScanInput() {
+    if (!keys_parsed)
+        ParseKeys();
+    if (pending_keys.empty()) {
+        keys_down = KEY_A;
+        return;
+    }
+    keys_down = pending_keys.front();
+    pending_keys.pop_front();
+}
+
+u32 hidKeysDown() {
+    return keys_down;
+}
+
+u32 hidKeysHeld() {
+    return keys_down;
+}
+
+bool aptMainLoop() {
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+
+#include <3ds.h>
+
+// What the kernel stand-in offers the DSP service beyond the libctru API.
+namespace HostCtru {
+
+/// Physical address of the start of the linear heap, where FCRAM begins on the 3DS.
+constexpr u32 linear_heap_paddr = 0x20000000;
+
+/// Creates an event like svcCreateEvent that also calls `on_signal` each time it is signalled.
+Handle CreateEvent(ResetType reset_type, std::function<void()> on_signal);
+
+/// Host pointer to `size` bytes of the linear heap at physical `address`, or nullptr.
+const u8* TranslatePhysical(u32 address, u32 size);
+
+/// How the software DSP's clock runs, from HOSTCTRU_DSP_CLOCK.
+enum class ClockMode {
+    FreeRunning, ///< "free" (the default): each frame is processed as soon as it is signalled.
+    RealTime,    ///< "realtime": one frame per hardware period of wall-clock time.
+    Simulated,   ///< "simulated": one frame per hardware period of simulated time.
+};
+
+ClockMode GetClockMode();
+
+/// Nanoseconds since startup on the system clock: the host's, or simulated time.
+u64 Now();
+
+/**
+ * In simulated time, the device whose ticks time moves between. Time only passes while the
+ * application sleeps or waits: svcSleepThread and svcWaitSynchronization run each tick that falls
+ * due on the calling thread, in order, so every run sees the same ticks at the same times.
+ * `next_tick` returns the time of the next tick, or U64_MAX while none is scheduled.
+ */
+void SetTickSource(std::function<u64()> next_tick, std::function<void()> tick);
+
+} // namespace HostCtru
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "host_ctru.h"
+
+// Events, the system clock and the linear heap.
+
+namespace {
+
+struct Event {
+    ResetType reset_type;
+    bool signaled = false;
+    /// Counts signals, so that waiters on a pulse event notice one they did not see set.
+    u64 generation = 0;
+    std::function<void()> on_signal;
+};
+
+std::mutex kernel_mutex;
+std::condition_variable kernel_cv;
+std::map<Handle, Event> events;
+Handle next_handle = 0x1000;
+
+/// Enough for every buffer the tests allocate; nothing is ever returned to it.
+constexpr size_t linear_heap_size = 32 * 1024 * 1024;
+constexpr size_t linear_alignment = 0x80;
+
+alignas(0x1000) u8 linear_heap[linear_heap_size];
+size_t linear_used = 0;
+std::mutex linear_mutex;
+
+const auto boot_time = std::chrono::steady_clock::now();
+
+/// Simulated time in nanoseconds, guarded by kernel_mutex.
+u64 simulated_now = 0;
+std::function<u64()> tick_source_next;
+std::function<void()> tick_source_tick;
+
+u64 NextTick() {
+    return tick_source_next ? tick_source_next() : U64_MAX;
+}
+
+/// Moves simulated time to `time`, where the tick source is due, and runs its tick. Called
+/// without kernel_mutex, which the tick takes to signal events.
+bool RunTick(u64 time) {
+    if (time == U64_MAX)
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(kernel_mutex);
+        simulated_now = std::max(simulated_now, time);
+    }
+    tick_source_tick();
+    return true;
+}
+
+} // anonymous namespace
+
+namespace HostCtru {
+
+Handle CreateEvent(ResetType reset_type, std::function<void()> on_signal) {
+    std::lock_guard<std::mutex> lock(kernel_mutex);
+    const Handle handle = next_handle++;
+    Event& event = events[handle];
+    event.reset_type = reset_type;
+    event.on_signal = std::move(on_signal);
+    return handle;
+}
+
+const u8* TranslatePhysical(u32 address, u32 size) {
+    if (address < linear_heap_paddr)
+        return nullptr;
+    const size_t offset = address - linear_heap_paddr;
+    if (offset > linear_heap_size || size > linear_heap_size - offset)
+        return nullptr;
+    return linear_heap + offset;
+}
+
+ClockMode GetClockMode() {
+    static const ClockMode mode = [] {
+        const char* const value = std::getenv("HOSTCTRU_DSP_CLOCK");
+        if (!value || std::strcmp(value, "free") == 0)
+            return ClockMode::FreeRunning;
+        if (std::strcmp(value, "realtime") == 0)
+            return ClockMode::RealTime;
+        if (std::strcmp(value, "simulated") == 0)
+            return ClockMode::Simulated;
+        std::fprintf(stderr, "HOSTCTRU_DSP_CLOCK: unknown clock %s, running free\n", value);
+        return ClockMode::FreeRunning;
+    }();
+    return mode;
+}
+
+u64 Now() {
+    if (GetClockMode() == ClockMode::Simulated) {
+        std::lock_guard<std::mutex> lock(kernel_mutex);
+        return simulated_now;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - boot_time;
+    return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void SetTickSource(std::function<u64()> next_tick, std::function<void()> tick) {
+    tick_source_next = std::move(next_tick);
+    tick_source_tick = std::move(tick);
+}
+
+} // namespace HostCtru
+
+Result svcCreateEvent(Handle* event, ResetType reset_type) {
+    *event = HostCtru::CreateEvent(reset_type, {});
+    return 0;
+}
+
+Result svcSignalEvent(Handle handle) {
+    std::function<void()> on_signal;
+    {
+        std::lock_guard<std::mutex> lock(kernel_mutex);
+        const auto it = events.find(handle);
+        if (it == events.end())
+            return RES_INVALID_HANDLE;
+        Event& event = it->second;
+        event.signaled = event.reset_type != RESET_PULSE;
+        event.generation++;
+        on_signal = event.on_signal;
+    }
+    kernel_cv.notify_all();
+    if (on_signal)
+        on_signal();
+    return 0;
+}
+
+Result svcClearEvent(Handle handle) {
+    std::lock_guard<std::mutex> lock(kernel_mutex);
+    const auto it = events.find(handle);
+    if (it == events.end())
+        return RES_INVALID_HANDLE;
+    it->second.signaled = false;
+    return 0;
+}
+
+Result svcWaitSynchronization(Handle handle, s64 nanoseconds) {
+    std::unique_lock<std::mutex> lock(kernel_mutex);
+    auto it = events.find(handle);
+    if (it == events.end())
+        return RES_INVALID_HANDLE;
+
+    const u64 generation = it->second.generation;
+    const auto ready = [&] {
+        it = events.find(handle);
+        return it == events.end() || it->second.signaled || it->second.generation != generation;
+    };
+    if (HostCtru::GetClockMode() == HostCtru::ClockMode::Simulated) {
+        // Let simulated time run from tick to tick until the event is signalled. If no tick is
+        // coming, whatever signals it (the DSP answering a pipe command) does so in host time.
+        const u64 deadline = nanoseconds < 0 ? U64_MAX : simulated_now + static_cast<u64>(nanoseconds);
+        while (!ready()) {
+            lock.unlock();
+            const u64 tick_time = NextTick();
+            const bool ticked = tick_time <= deadline && RunTick(tick_time);
+            lock.lock();
+            if (!ticked)
+                break;
+        }
+        if (!ready() && deadline != U64_MAX) {
+            simulated_now = std::max(simulated_now, deadline);
+            return RES_TIMEOUT;
+        }
+    }
+
+    // U64_MAX, the usual "forever", arrives here as -1.
+    if (nanoseconds < 0) {
+        kernel_cv.wait(lock, ready);
+    } else if (!kernel_cv.wait_for(lock, std::chrono::nanoseconds(nanoseconds), ready)) {
+        return RES_TIMEOUT;
+    }
+
+    if (it == events.end())
+        return RES_INVALID_HANDLE;
+    if (it->second.reset_type == RESET_ONESHOT)
+        it->second.signaled = false;
+    return 0;
+}
+
+Result svcCloseHandle(Handle handle) {
+    {
+        std::lock_guard<std::mutex> lock(kernel_mutex);
+        if (events.erase(handle) == 0)
+            return RES_INVALID_HANDLE;
+    }
+    kernel_cv.notify_all();
+    return 0;
+}
+
+u64 svcGetSystemTick() {
+    return static_cast<u64>(static_cast<double>(HostCtru::Now()) * (SYSCLOCK_ARM11 / 1e9));
+}
+
+void svcSleepThread(s64 nanoseconds) {
+    if (nanoseconds <= 0)
+        return;
+    if (HostCtru::GetClockMode() != HostCtru::ClockMode::Simulated) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(nanoseconds));
+        return;
+    }
+
+    const u64 wake_time = HostCtru::Now() + static_cast<u64>(nanoseconds);
+    for (u64 tick_time = NextTick(); tick_time <= wake_time; tick_time = NextTick())
+        RunTick(tick_time);
+    std::lock_guard<std::mutex> lock(kernel_mutex);
+    simulated_now = std::max(simulated_now, wake_time);
+}
+
+void* linearAlloc(size_t size) {
+    std::lock_guard<std::mutex> lock(linear_mutex);
+    const size_t offset = (linear_used + linear_alignment - 1) & ~(linear_alignment - 1);
+    if (offset > linear_heap_size || size > linear_heap_size - offset)
+        return nullptr;
+    linear_used = offset + size;
+    return linear_heap + offset;
+}
+
+void linearFree(void*) {}
+
+u32 osConvertVirtToPhys(const void* vaddr) {
+    const u8* const pointer = static_cast<const u8*>(vaddr);
+    if (pointer < linear_heap || pointer >= linear_heap + linear_heap_size)
+        return 0;
+    return HostCtru::linear_heap_paddr + static_cast<u32>(pointer - linear_heap);
+}
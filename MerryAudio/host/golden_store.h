@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include "common_types.h"
+#include "random.h"
+
+/**
+ * Golden vectors captured on hardware, in a flat binary store built by AudioTool-GoldenImport.
+ *
+ * Each capture is keyed by the test that produced it and that test's parameters. The store is an
+ * open-addressed hash table of entries followed by the sample values, so it can be mapped or read
+ * into memory as a whole and queried in place:
+ *
+ *     const GoldenStore store(data, size);
+ *     const GoldenEntry* entry = store.Find(GoldenKey::InterpLinear(0.4f));
+ *     if (entry)
+ *         compare(store.Values(*entry), entry->count);
+ *
+ * The store is written in host byte order and is meant for host tools only.
+ */
+namespace DSP {
+namespace HLE {
+
+/// The hardware test a capture comes from.
+enum class GoldenTest : u32 {
+    None = 0,
+    InterpLinear = 1,           ///< AudioTest-InterpLinear-ToFile: mix1 front left, low 16 bits.
+    PolyphaseImpulse = 2,       ///< AudioTest-InterpPolyphase-Impulse: mix1 front left.
+    FrameDelayIntermediate = 3, ///< AudioTest-FrameDelay: mix1 front left.
+    FrameDelayFinal = 4,        ///< AudioTest-FrameDelay: final samples, interleaved stereo.
+};
+
+struct GoldenKey {
+    GoldenTest test = GoldenTest::None;
+    u32 params[2] = {};
+
+    /// Rate multipliers are logged with six decimals, so they are keyed by millionths.
+    static u32 Rate(float rate_multiplier) {
+        return static_cast<u32>(static_cast<double>(rate_multiplier) * 1e6 + 0.5);
+    }
+
+    static GoldenKey InterpLinear(float rate_multiplier) {
+        return {GoldenTest::InterpLinear, {Rate(rate_multiplier), 0}};
+    }
+
+    static GoldenKey PolyphaseImpulse(unsigned coefficients, float rate_multiplier) {
+        return {GoldenTest::PolyphaseImpulse, {coefficients, Rate(rate_multiplier)}};
+    }
+
+    /// FrameDelay logs every frame from the first audible intermediate mix to the first audible
+    /// final mix, so its captures are keyed by frame.
+    static GoldenKey FrameDelayIntermediate(u32 frame) {
+        return {GoldenTest::FrameDelayIntermediate, {frame, 0}};
+    }
+
+    static GoldenKey FrameDelayFinal(u32 frame) {
+        return {GoldenTest::FrameDelayFinal, {frame, 0}};
+    }
+
+    bool operator==(const GoldenKey& other) const {
+        return test == other.test && params[0] == other.params[0] && params[1] == other.params[1];
+    }
+
+    /// Slot hash (a round of splitmix64 over the key).
+    u64 Hash() const {
+        return SplitMix64((static_cast<u64>(test) << 32 | params[0]) ^ (static_cast<u64>(params[1]) * splitmix64_gamma));
+    }
+};
+
+struct GoldenEntry {
+    GoldenKey key;     ///< key.test is None in empty slots.
+    u32 frame;         ///< Frame the capture was taken in, or golden_frame_not_logged.
+    u16 first_sample;  ///< First non-zero sample of that frame.
+    u16 bits;          ///< Significant low bits of each value (16 or 32), sign-extended to s32.
+    u32 count;         ///< Number of values.
+    u32 offset;        ///< Index of the first value in the value array.
+};
+
+struct GoldenHeader {
+    char magic[8];
+    u32 version;
+    u32 slot_count; ///< A power of two, at least twice the entry count.
+    u32 entry_count;
+    u32 value_count;
+};
+
+static_assert(sizeof(GoldenEntry) == 28, "GoldenEntry is part of the file format");
+static_assert(sizeof(GoldenHeader) == 24, "GoldenHeader is part of the file format");
+
+constexpr char golden_magic[8] = {'M', 'A', 'G', 'O', 'L', 'D', 'E', 'N'};
+constexpr u32 golden_version = 1;
+constexpr u32 golden_frame_not_logged = 0xFFFFFFFF;
+
+/// Read-only view of a store in memory. The memory must outlive the view.
+class GoldenStore {
+public:
+    GoldenStore() = default;
+
+    /// Validates the header and sizes. An invalid store behaves as an empty one.
+    GoldenStore(const void* data, size_t size) {
+        if (size < sizeof(GoldenHeader))
+            return;
+        GoldenHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, golden_magic, sizeof(golden_magic)) != 0 || header.version != golden_version)
+            return;
+        if (header.slot_count == 0 || (header.slot_count & (header.slot_count - 1)) != 0)
+            return;
+        const size_t expected = sizeof(GoldenHeader) + static_cast<size_t>(header.slot_count) * sizeof(GoldenEntry) +
+                                static_cast<size_t>(header.value_count) * sizeof(s32);
+        if (size < expected)
+            return;
+
+        const u8* bytes = static_cast<const u8*>(data);
+        slots = reinterpret_cast<const GoldenEntry*>(bytes + sizeof(GoldenHeader));
+        values = reinterpret_cast<const s32*>(slots + header.slot_count);
+        slot_mask = header.slot_count - 1;
+        entry_count = header.entry_count;
+        value_count = header.value_count;
+    }
+
+    bool IsValid() const {
+        return slots != nullptr;
+    }
+
+    size_t EntryCount() const {
+        return entry_count;
+    }
+
+    /// Returns the capture for `key`, or nullptr. Expected O(1): the table is at most half full.
+    const GoldenEntry* Find(const GoldenKey& key) const {
+        if (!slots)
+            return nullptr;
+        u32 slot = static_cast<u32>(key.Hash()) & slot_mask;
+        for (u32 probes = 0; probes <= slot_mask; probes++, slot = (slot + 1) & slot_mask) {
+            const GoldenEntry& entry = slots[slot];
+            if (entry.key.test == GoldenTest::None)
+                return nullptr;
+            if (entry.key == key)
+                return entry.offset + static_cast<u64>(entry.count) <= value_count ? &entry : nullptr;
+        }
+        return nullptr;
+    }
+
+    const s32* Values(const GoldenEntry& entry) const {
+        return values + entry.offset;
+    }
+
+    /// Visits every entry, in slot order.
+    template <typename Visitor>
+    void ForEach(Visitor&& visit) const {
+        if (!slots)
+            return;
+        for (u32 slot = 0; slot <= slot_mask; slot++) {
+            if (slots[slot].key.test != GoldenTest::None)
+                visit(slots[slot]);
+        }
+    }
+
+private:
+    const GoldenEntry* slots = nullptr;
+    const s32* values = nullptr;
+    u32 slot_mask = 0;
+    u32 entry_count = 0;
+    u32 value_count = 0;
+};
+
+} // namespace HLE
+} // namespace DSP
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common_types.h"
+
+/**
+ * splitmix64, shared by the host tools: the pseudo-random streams that drive their scenes, and
+ * the hash of golden store keys. Small, fast, and the same sequence on every host for a seed.
+ *
+ * The headers in this directory are for host tools only and are not part of the 3DS library.
+ */
+namespace DSP {
+namespace HLE {
+
+/// splitmix64's increment, the odd integer closest to 2^64 / phi.
+constexpr u64 splitmix64_gamma = 0x9E3779B97F4A7C15ull;
+
+/// splitmix64's output function: a bijective mix of all 64 bits.
+constexpr u64 SplitMix64(u64 z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+class Random {
+public:
+    explicit Random(u64 seed) : state(seed) {}
+
+    u64 Next() {
+        return SplitMix64(state += splitmix64_gamma);
+    }
+
+    u32 Below(u32 bound) {
+        return static_cast<u32>(Next() % bound);
+    }
+
+    /// True with probability percent / 100.
+    bool Chance(u32 percent) {
+        return Below(100) < percent;
+    }
+
+    float Between(float lo, float hi) {
+        return lo + (hi - lo) * static_cast<float>(Next() >> 40) / static_cast<float>(1 << 24);
+    }
+
+private:
+    u64 state;
+};
+
+} // namespace HLE
+} // namespace DSP
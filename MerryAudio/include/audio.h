@@ -1,5 +1,8 @@
 #include <array>
+#include <cstddef>
 #include <experimental/optional>
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include <3ds.h>
@@ -27,6 +30,8 @@ struct SharedMem {
     volatile DSP::HLE::DspDebug* dsp_debug; // access through read()
 };
 
+struct FrameSnapshot;
+
 struct AudioState {
     Handle pipe2_irq = 0;
     Handle dsp_semaphore = 0;
@@ -38,9 +43,194 @@ struct AudioState {
     const SharedMem& read() const;
     const SharedMem& write() const;
     void waitForSync();
+    /// Waits for the DSP, then captures what it returned into `snapshot`.
+    void waitForSync(FrameSnapshot& snapshot);
     void notifyDsp();
 };
 
+/**
+ * Cached copy of what the DSP returned in one frame.
+ *
+ * Reading the shared structs through their volatile pointers costs an uncached access per sample.
+ * Code that scans samples, or reads them more than once, should capture a snapshot right after
+ * waitForSync and work on that. The structs are large (about 6 KB together), so keep a snapshot
+ * static or on the heap rather than on the stack.
+ */
+struct FrameSnapshot {
+    u16 frame_counter;
+    alignas(32) DSP::HLE::SourceStatus source_statuses;
+    alignas(32) DSP::HLE::DspStatus dsp_status;
+    alignas(32) DSP::HLE::IntermediateMixSamples intermediate_mix_samples;
+    alignas(32) DSP::HLE::FinalMixSamples final_samples;
+
+    /// Copies the region the DSP last returned, with one bulk copy per struct.
+    void capture(const AudioState& state);
+};
+
+/**
+ * Runs per-frame work on top of AudioState, so a test states what it waits for instead of
+ * hand-writing waitForSync/notifyDsp loops.
+ *
+ * Work is registered as tasks: callbacks that run every frame, and conditions on the statuses
+ * the DSP returned ("source 0 reports sync 2", "source 3 moved to another buffer") with an action
+ * to run once they hold. Each frame the scheduler waits for the DSP, runs every task in
+ * registration order, and notifies the DSP exactly once. Tasks registered while a frame runs
+ * start with the next frame.
+ *
+ * The time from the DSP's interrupt to the notification is measured against a deadline, by
+ * default one frame (160 samples at 32728 Hz). Frames the DSP reports dropping because the
+ * notification came too late are counted too.
+ *
+ *     FrameScheduler scheduler(state);
+ *     scheduler.whenSync(0, 2, [&](AudioState& s) { ...start playback... });
+ *     scheduler.onBufferChange(0, [&](AudioState& s, u16 id) { ...queue the next buffer... });
+ *     scheduler.runFrames(2000);
+ */
+class FrameScheduler {
+public:
+    using Handle = u32;
+    using Condition = function<bool(const AudioState&)>;
+    using Action = function<void(AudioState&)>;
+
+    struct Stats {
+        u64 frames = 0;
+        u64 late_frames = 0; ///< Frames whose work overran the deadline.
+        u64 max_ticks = 0;   ///< Longest work of a frame, in svcGetSystemTick ticks.
+        u64 total_ticks = 0;
+        u64 dropped_frames = 0; ///< Frames the DSP dropped waiting for us, from DspStatus.
+    };
+
+    explicit FrameScheduler(AudioState& state);
+
+    /// Runs `action` every frame until cancelled.
+    Handle everyFrame(Action action);
+
+    /// Runs `action` once, in the first frame in which `condition` holds.
+    Handle when(Condition condition, Action action);
+
+    /// Runs `action` once, in the first frame in which source `source` reports sync value `sync`.
+    Handle whenSync(size_t source, u16 sync, Action action);
+
+    /// Runs `action` with the new current_buffer_id every frame in which source `source` reports
+    /// a buffer change, until cancelled.
+    Handle onBufferChange(size_t source, function<void(AudioState&, u16 buffer_id)> action);
+
+    /// Removes a task. Cancelling a task that already finished does nothing.
+    void cancel(Handle handle);
+
+    /// Waits for the DSP and runs this frame's tasks. The frame stays open, so the caller can add
+    /// writes of its own, until endFrame. Closes a frame left open first.
+    void beginFrame();
+
+    /// Notifies the DSP, closing the open frame. Does nothing if no frame is open.
+    void endFrame();
+
+    /// beginFrame and endFrame.
+    void runFrame();
+
+    void runFrames(size_t count);
+
+    /**
+     * Runs frames until `condition` holds after a frame's tasks, or `max_frames` frames have run.
+     * Returns with that last frame open, so the caller can react within it before endFrame.
+     * @return Whether the condition held.
+     */
+    bool runUntil(const Condition& condition, size_t max_frames = SIZE_MAX);
+
+    /// Number of frames begun so far.
+    u64 frame() const {
+        return frames_begun;
+    }
+
+    void setDeadline(u64 ticks) {
+        deadline_ticks = ticks;
+    }
+
+    const Stats& stats() const {
+        return frame_stats;
+    }
+
+    /// Captures a FrameSnapshot at the start of every frame, before the tasks run.
+    void enableSnapshots();
+
+    /// The snapshot of the current frame. Only valid once enableSnapshots has been called.
+    const FrameSnapshot& snapshot() const {
+        return *frame_snapshot;
+    }
+
+private:
+    struct Task {
+        Handle handle;
+        Condition condition; ///< Empty for tasks that run every frame.
+        Action action;
+        bool repeat;
+        bool done;
+    };
+
+    Handle add(Condition condition, Action action, bool repeat);
+
+    AudioState& state;
+    vector<Task> tasks;
+    /// Tasks registered while a frame runs, added once it is over.
+    vector<Task> added;
+    bool running = false;
+    bool frame_open = false;
+    Handle next_handle = 1;
+    u64 frames_begun = 0;
+    u64 frame_start = 0;
+    u64 deadline_ticks;
+    /// DspStatus::dropped_frames when last read, or when the scheduler was made, so frames dropped
+    /// before then are not counted. The DSP's count wraps at 16 bits.
+    u16 dsp_dropped_frames;
+    Stats frame_stats;
+    unique_ptr<FrameSnapshot> frame_snapshot;
+};
+
+/**
+ * Stages configuration edits for one frame in cached memory, then commits them to the write
+ * region in bulk.
+ *
+ * Editing the shared structs directly costs an uncached access per field, and a read-modify-write
+ * per dirty flag. Here the first access to a block copies it from shared memory in one read;
+ * edits, dirty flags included, then go to the copy. commit() writes each touched block back in one
+ * store, dirty word aside, and then ORs the accumulated dirty flags into the shared dirty word.
+ *
+ * The write region is fixed when the writer is made, so make one per frame, after waitForSync,
+ * and commit before notifyDsp. The destructor commits anything left.
+ *
+ *     ConfigWriter writer(state);
+ *     writer.source(0).enable = true;
+ *     writer.source(0).enable_dirty.Assign(1);
+ *     writer.commit();
+ */
+class ConfigWriter {
+public:
+    using Configuration = DSP::HLE::SourceConfiguration::Configuration;
+
+    explicit ConfigWriter(const AudioState& state);
+    ~ConfigWriter();
+
+    ConfigWriter(const ConfigWriter&) = delete;
+    ConfigWriter& operator=(const ConfigWriter&) = delete;
+
+    /// The staged configuration of source `index`. Its BitFields are not volatile, so set them
+    /// with Assign.
+    Configuration& source(size_t index);
+
+    /// The staged DSP configuration.
+    DSP::HLE::DspConfiguration& dsp();
+
+    /// Writes every touched block to shared memory. Later edits stage from scratch.
+    void commit();
+
+private:
+    const SharedMem& region;
+    u32 touched_sources = 0; ///< Bit i -> sources[i] is staged.
+    bool touched_dsp = false;
+    array<Configuration, AudioCore::num_sources> sources;
+    DSP::HLE::DspConfiguration dsp_configuration;
+};
+
 optional<vector<u8>> loadDspFirmFromFile();
 optional<AudioState> audioInit(vector<u8> dspfirm);
 void audioExit(const AudioState& state);
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+#include "common_types.h"
+
+namespace DSP {
+namespace HLE {
+
+/**
+ * Models the embedded buffer and the four-slot buffer queue of a source.
+ *
+ * Buffers play in order of buffer_id. Instead of being asked for one sample at a time, the queue
+ * hands out the input a frame needs as spans: contiguous runs of samples from a single buffer. A
+ * span boundary is the only place a buffer can end, so the decode and interpolation kernels never
+ * test for the end of a buffer per sample. Everything is held in fixed-size arrays, so short,
+ * rapidly requeued buffers cost no allocation.
+ */
+class BufferQueue {
+public:
+    /// Buffers that can wait in the queue. Pushing to a full queue drops the new buffer.
+    static constexpr size_t capacity = 8;
+
+    struct Buffer {
+        PAddr physical_address = 0;
+        u32 length = 0;         ///< In samples.
+        u32 play_position = 0;  ///< Where the first playthrough starts.
+        u16 buffer_id = 0;
+        s16 adpcm_yn[2] = {};
+        bool adpcm_dirty = false;
+        bool is_looping = false;
+        bool from_queue = false; ///< False for the embedded buffer.
+        bool has_played = false; ///< Set on the copies a looping buffer requeues.
+    };
+
+    /// A contiguous run of samples from one buffer.
+    struct Span {
+        const Buffer* buffer;
+        u32 offset; ///< First sample within the buffer.
+        u32 count;
+        bool starts_buffer; ///< First span of a playthrough; ADPCM history is reloaded here.
+    };
+
+    /// Drops all buffers, including the one playing (reset_flag).
+    void Reset();
+
+    /// Drops the waiting buffers (partial_reset_flag). The buffer playing finishes, but does not loop.
+    void ClearPending();
+
+    void Push(const Buffer& buffer);
+
+    /**
+     * Makes sure a buffer with samples left is playing, starting the next one if needed.
+     * @return false if every buffer has finished, in which case the source stops.
+     */
+    bool Prime();
+
+    /// Latches the position reported in SourceStatus for this frame.
+    void BeginFrame() {
+        status_position = position;
+    }
+
+    /**
+     * Hands out the next `count` samples as spans, moving through buffers as they finish.
+     * @return The number of samples delivered, less than count only if the queue ran dry.
+     */
+    template <typename Visitor>
+    u32 Consume(u32 count, Visitor&& visit) {
+        u32 delivered = 0;
+        while (delivered < count) {
+            if (position >= current.length && !Advance())
+                break;
+
+            const u32 n = std::min(count - delivered, current.length - position);
+            visit(Span{&current, position, n, fresh});
+            fresh = false;
+            position += n;
+            delivered += n;
+        }
+        return delivered;
+    }
+
+    u16 CurrentBufferId() const {
+        return playing ? current.buffer_id : 0;
+    }
+
+    /// Samples into the current buffer at the start of the frame, or where it started if it
+    /// started during the frame.
+    u32 StatusPosition() const {
+        return status_position;
+    }
+
+    /// Returns whether the current buffer id changed since the last call, and clears the flag.
+    bool TakeBufferUpdate() {
+        const bool ret = buffer_update;
+        buffer_update = false;
+        return ret;
+    }
+
+private:
+    /// Finishes the current buffer and starts the next one. Returns false if there is none.
+    bool Advance();
+
+    // The playing buffer and the read position come first: they are all a frame touches unless
+    // a buffer finishes.
+    Buffer current{};
+    u32 position = 0;        ///< Next sample to read from the current buffer.
+    u32 status_position = 0;
+    bool playing = false;
+    bool fresh = false;
+    bool buffer_update = false;
+
+    size_t pending_count = 0;
+    std::array<Buffer, capacity> pending{}; ///< Sorted by buffer_id.
+};
+
+} // namespace HLE
+} // namespace DSP
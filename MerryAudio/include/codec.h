@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+
+#include "common_types.h"
+#include "dsp.h"
+
+namespace DSP {
+namespace HLE {
+namespace Codec {
+
+using Format = SourceConfiguration::Configuration::Format;
+
+/// ADPCM frames are 8 bytes: a header byte followed by 14 four-bit samples.
+constexpr u32 adpcm_frame_bytes = 8;
+constexpr u32 adpcm_frame_samples = 14;
+
+/// History of the ADPCM predictor, y[n-1] and y[n-2].
+struct AdpcmState {
+    s16 yn1 = 0;
+    s16 yn2 = 0;
+};
+
+/// Number of bytes `samples` samples occupy in memory.
+u32 BytesForSamples(Format format, unsigned channels, u32 samples);
+
+/**
+ * Decodes samples [offset, offset + count) of a PCM buffer into planar output.
+ * For mono input only `left` is written. Stereo input is widened and deinterleaved eight frames at
+ * a time; the buffer may have any alignment.
+ */
+void DecodePCM8(const u8* data, unsigned channels, u32 offset, u32 count, s16* left, s16* right);
+void DecodePCM16(const u8* data, unsigned channels, u32 offset, u32 count, s16* left, s16* right);
+
+/**
+ * Decodes samples [offset, offset + count) of a mono ADPCM buffer, continuing from `state`.
+ * @param coeffs Predictor coefficients, signed fixed point with 11 fractional bits.
+ */
+void DecodeADPCM(const u8* data, u32 offset, u32 count, const std::array<s16, 16>& coeffs, AdpcmState& state, s16* out);
+
+} // namespace Codec
+} // namespace HLE
+} // namespace DSP
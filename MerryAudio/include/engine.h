@@ -0,0 +1,214 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <type_traits>
+
+#include "common_types.h"
+#include "dsp.h"
+#include "hle_common.h"
+#include "interpolate.h"
+#include "mixers.h"
+#include "source.h"
+
+namespace DSP {
+namespace HLE {
+
+/// Deviation of the preview output from the bit-exact output, over all final mix samples compared.
+struct ErrorStats {
+    u64 samples = 0;
+    s32 max_deviation = 0;
+    /// Of the signed deviations, measured minus reference.
+    double sum = 0.0;
+    double sum_of_squares = 0.0;
+
+    /// The steady offset of the measured output. RmsDeviation includes it.
+    double MeanDeviation() const {
+        return samples ? sum / static_cast<double>(samples) : 0.0;
+    }
+
+    double RmsDeviation() const {
+        return samples ? std::sqrt(sum_of_squares / static_cast<double>(samples)) : 0.0;
+    }
+};
+
+/**
+ * Everything an engine carries from one frame to the next: the sources with their buffer queues,
+ * filter and interpolation history, the mixers with their effect delay lines, and the frame id.
+ *
+ * It holds no pointers, so it is one trivially copyable blob: a snapshot is a memcpy, and stays
+ * valid in other runs of the same build. Engine settings (precision, silence threshold) and the
+ * error meter are not restored from it.
+ */
+struct EngineState {
+    std::array<Source, AudioCore::num_sources> sources;
+    Mixers mixers;
+    /// frame_counter of the last region processed. Its parity tells which of the two shared
+    /// memory regions the application writes next.
+    u16 frame_id = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<EngineState>, "EngineState must be restorable with memcpy");
+
+/**
+ * Receives the intermediate results of each frame, for debugging tools such as differential
+ * testers. An engine without a probe pays one null check per source and frame.
+ */
+class EngineProbe {
+public:
+    virtual ~EngineProbe() = default;
+
+    /// Output of one source after decoding, resampling and filtering. Skipped sources have none.
+    virtual void SourceOutput(const SharedMemory& region, size_t source, const StereoFrame16& output) = 0;
+
+    /// The three intermediate mixes once every source is mixed in, before the effects run.
+    virtual void IntermediateMixes(const SharedMemory& region, const std::array<QuadFrame32, 3>& mixes) = 0;
+};
+
+/**
+ * Software model of the DSP audio pipeline. Each Tick consumes the configuration in one shared
+ * memory region and produces one frame of statuses and samples into the same region.
+ */
+class Engine {
+public:
+    explicit Engine(MemoryTranslator memory);
+
+    void Reset();
+
+    /// Processes one audio frame using the given region.
+    void Tick(SharedMemory& region);
+
+    /// Most frames a batch of Render can hold.
+    static constexpr size_t max_batch_frames = 8;
+
+    /**
+     * Processes `count` consecutive frames for offline rendering, frame k using regions[k]. The
+     * regions must be distinct and already hold each frame's configuration. Every region receives
+     * exactly the statuses and samples that Tick would write to it.
+     *
+     * Unless batching is turned on with SetBatchFrames, this is Tick frame by frame. In batches,
+     * each source runs through every frame of a batch before the next source starts, so its
+     * decoder, interpolator and filter state stay in cache; the mixers then run frame by frame.
+     * Whether that pays depends on the cache: AudioBench-FrameBatching measures it on a host and
+     * AudioTest-FrameBatching on the 3DS. With the error meter or a probe, frames go one at a time.
+     */
+    void Render(SharedMemory* const* regions, size_t count);
+
+    /**
+     * Sets the frames per batch used by Render, at most max_batch_frames. 1 (the default) turns
+     * batching off. 0 picks it by timing each candidate over the next frames rendered.
+     */
+    void SetBatchFrames(size_t frames);
+
+    /// Frames per batch Render currently uses, or 0 while still tuning.
+    size_t BatchFrames() const {
+        return tuner.chosen;
+    }
+
+    /// Selects bit-exact fixed-point processing (the default) or the float preview pipelines.
+    void SetPrecision(Precision precision);
+
+    /// Copies the complete engine state into `out`, e.g. to checkpoint a render or fork it.
+    void SaveState(EngineState& out) const;
+
+    /**
+     * Continues from a state saved earlier, by this or any other engine. The precision set on this
+     * engine is kept, whichever one the saving engine used.
+     */
+    void LoadState(const EngineState& in);
+
+    /// frame_counter of the last region processed.
+    u16 FrameId() const {
+        return state.frame_id;
+    }
+
+    /// Attaches a probe, or detaches it with nullptr. The engine does not own it.
+    void SetProbe(EngineProbe* probe_) {
+        probe = probe_;
+    }
+
+    /**
+     * While enabled, every Tick also runs a bit-exact copy of the engine on a copy of the region
+     * and compares the two final mixes. The copy starts from the current state. This roughly
+     * doubles the cost of a frame, so it is meant for measuring, not for normal playback.
+     */
+    void EnableErrorMeter(bool enable);
+
+    const ErrorStats& GetErrorStats() const {
+        return error_stats;
+    }
+
+    void ResetErrorStats() {
+        error_stats = {};
+    }
+
+    /**
+     * Sources whose last rendered frame peaked below `peak` are skipped until a buffer is queued
+     * or started, as if silent, rendering a frame now and then to measure their level again. This
+     * changes the output. 0 (the default) skips only sources with all gains at zero and both
+     * filters off, which does not change the output.
+     */
+    void SetSilenceThreshold(u16 peak) {
+        silence_threshold = peak;
+    }
+
+    /**
+     * Whether sources with all gains at zero and both filters off are skipped (the default).
+     * Rendering them instead costs time without changing the output, which AudioTool-DiffTest's
+     * "render" variant checks.
+     */
+    void SetSkipMuted(bool enable) {
+        skip_muted = enable;
+    }
+
+    /// Number of enabled sources skipped as inaudible during the last frame processed.
+    size_t SkippedSources() const {
+        return skipped_sources;
+    }
+
+private:
+    using Mixes = std::array<QuadFrame32, 3>;
+
+    /// Times the candidate batch sizes in turn and keeps the fastest.
+    struct BatchTuner {
+        static constexpr std::array<size_t, 4> candidates{{1, 2, 4, max_batch_frames}};
+        /// Frames timed per candidate.
+        static constexpr size_t frames_per_candidate = 64;
+
+        size_t chosen = 1;
+        size_t candidate = 0;
+        size_t frames_timed = 0;
+        /// Profiler::Now ticks spent per candidate.
+        std::array<u64, candidates.size()> ticks{};
+    };
+
+    void Process(SharedMemory& region);
+    /// Processes up to max_batch_frames frames source by source, frame k into mixes[k].
+    void ProcessBatch(SharedMemory* const* regions, size_t count, Mixes* mixes);
+    void MeasureError(const FinalMixSamples& expected, const FinalMixSamples& actual);
+
+    MemoryTranslator memory;
+    Precision precision = Precision::BitExact;
+    u16 silence_threshold = 0;
+    bool skip_muted = true;
+    size_t skipped_sources = 0;
+    EngineProbe* probe = nullptr;
+    BatchTuner tuner;
+
+    std::unique_ptr<Engine> reference;
+    std::unique_ptr<SharedMemory> reference_region;
+    ErrorStats error_stats;
+
+    EngineState state;
+
+    alignas(16) Mixes intermediate_mixes;
+    /// Intermediate mixes of each frame of a batch, allocated by the first batched Render.
+    std::unique_ptr<std::array<Mixes, max_batch_frames>> batch_mixes;
+    alignas(16) AudioInterp::StagingBuffer staging;
+    /// Output of the source being processed.
+    alignas(16) StereoFrame16 source_output;
+};
+
+} // namespace HLE
+} // namespace DSP
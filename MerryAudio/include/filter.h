@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+
+#include "common_types.h"
+#include "dsp.h"
+#include "fixed_point.h"
+#include "hle_common.h"
+
+namespace DSP {
+namespace HLE {
+
+/// The simple and biquad filters of a source. They run after interpolation, biquad first. A source
+/// reset replaces the whole object, so the coefficients go with the history.
+class SourceFilters {
+public:
+    void Enable(bool enable_simple, bool enable_biquad);
+    void Configure(const SourceConfiguration::Configuration::SimpleFilter& config);
+    void Configure(const SourceConfiguration::Configuration::BiquadFilter& config);
+
+    bool IsSimpleEnabled() const {
+        return simple_enabled;
+    }
+    bool IsBiquadEnabled() const {
+        return biquad_enabled;
+    }
+
+    /**
+     * Filters the first `channels` channels of a frame in place. The enabled filters are template
+     * parameters so each source pipeline only contains the filters it runs.
+     */
+    template <bool simple_on, bool biquad_on>
+    void Process(StereoFrame16& frame, size_t channels) {
+        if constexpr (biquad_on)
+            ProcessBiquad(frame, channels);
+        if constexpr (simple_on)
+            ProcessSimple(frame, channels);
+    }
+
+    /// Float version of Process for the preview pipeline. Keeps its own filter history.
+    template <bool simple_on, bool biquad_on>
+    void ProcessPreview(StereoFrameFloat& frame, size_t channels) {
+        if constexpr (biquad_on)
+            ProcessBiquadPreview(frame, channels);
+        if constexpr (simple_on)
+            ProcessSimplePreview(frame, channels);
+    }
+
+private:
+    struct SimpleState {
+        Q15 b0{};
+        Q15 a1{};
+        std::array<s16, 2> y1{}; ///< Per channel.
+    };
+
+    struct BiquadState {
+        Q14 a1{}, a2{};
+        Q14 b0{}, b1{}, b2{};
+        std::array<s16, 2> x1{}, x2{}, y1{}, y2{};
+    };
+
+    /// Filter history of the preview pipeline, per channel.
+    struct PreviewState {
+        std::array<float, 2> simple_y1{};
+        std::array<float, 2> x1{}, x2{}, y1{}, y2{};
+    };
+
+    void ProcessSimple(StereoFrame16& frame, size_t channels);
+    void ProcessBiquad(StereoFrame16& frame, size_t channels);
+    void ProcessSimplePreview(StereoFrameFloat& frame, size_t channels);
+    void ProcessBiquadPreview(StereoFrameFloat& frame, size_t channels);
+
+    bool simple_enabled = false;
+    bool biquad_enabled = false;
+    SimpleState simple;
+    BiquadState biquad;
+    PreviewState preview;
+};
+
+} // namespace HLE
+} // namespace DSP
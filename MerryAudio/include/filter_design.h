@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cstddef>
+
+#include "common_types.h"
+#include "dsp.h"
+#include "hle_common.h"
+
+/**
+ * Designs the per-source filters and quantizes them to the DSP's formats.
+ *
+ * Designs are computed in double precision in standard notation and then quantized:
+ *   SimpleFilter: Q15, H(z) = b0 / (1 - a1 z^-1)
+ *   BiquadFilter: Q14, feedback coefficients negated, H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 - a1 z^-1 - a2 z^-2)
+ * Everything except the frequency response sweep is constexpr, so coefficient tables can be built
+ * at compile time:
+ *
+ *     constexpr auto lowpass = FilterDesign::Quantize(FilterDesign::LowPass(4000.0, 0.7071));
+ *     static_assert(FilterDesign::IsStable(lowpass));
+ *
+ * The biquad designs follow the RBJ audio EQ cookbook. Frequencies are in Hz and default to the
+ * DSP's native sample rate.
+ */
+namespace DSP {
+namespace HLE {
+namespace FilterDesign {
+
+using SimpleFilter = SourceConfiguration::Configuration::SimpleFilter;
+using BiquadFilter = SourceConfiguration::Configuration::BiquadFilter;
+
+/// First-order section in the DSP's notation: y[n] = b0 x[n] + a1 y[n-1].
+struct OnePole {
+    double b0;
+    double a1;
+};
+
+/// Second-order section in standard notation, normalised so a0 = 1:
+/// y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2].
+struct Biquad {
+    double b0, b1, b2;
+    double a1, a2;
+};
+
+namespace detail {
+
+constexpr double pi = 3.14159265358979323846;
+constexpr double ln2 = 0.69314718055994530942;
+constexpr double ln10 = 2.30258509299404568402;
+
+constexpr double Abs(double x) {
+    return x < 0.0 ? -x : x;
+}
+
+constexpr double Sqrt(double x) {
+    if (x <= 0.0)
+        return 0.0;
+    double guess = x < 1.0 ? 1.0 : x;
+    for (int i = 0; i < 64; i++) {
+        const double next = 0.5 * (guess + x / guess);
+        if (next == guess)
+            break;
+        guess = next;
+    }
+    return guess;
+}
+
+/// Sine, reduced to [-pi, pi] and evaluated with its Taylor series.
+constexpr double Sin(double x) {
+    const double turns = x / (2.0 * pi);
+    const long long whole = static_cast<long long>(turns < 0.0 ? turns - 0.5 : turns + 0.5);
+    x -= static_cast<double>(whole) * 2.0 * pi;
+
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 16; n++) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double Cos(double x) {
+    return Sin(x + pi / 2.0);
+}
+
+/// e^x, reduced to e^r * 2^k with |r| <= ln2 / 2.
+constexpr double Exp(double x) {
+    const long long k = static_cast<long long>(x / ln2 + (x < 0.0 ? -0.5 : 0.5));
+    const double r = x - static_cast<double>(k) * ln2;
+
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 20; n++) {
+        term *= r / n;
+        sum += term;
+    }
+
+    for (long long i = 0; i < k; i++)
+        sum *= 2.0;
+    for (long long i = 0; i > k; i--)
+        sum *= 0.5;
+    return sum;
+}
+
+/// 10^(db / 40): the amplitude of the shelf and peaking designs.
+constexpr double ShelfAmplitude(double gain_db) {
+    return Exp(gain_db / 40.0 * ln10);
+}
+
+/// Rounds to the nearest integer and saturates to s16.
+constexpr s16 QuantizeTo(double value, int fractional_bits) {
+    const double scaled = value * static_cast<double>(1 << fractional_bits);
+    const double rounded = scaled < 0.0 ? scaled - 0.5 : scaled + 0.5;
+    if (rounded >= 32767.0)
+        return 32767;
+    if (rounded <= -32768.0)
+        return -32768;
+    return static_cast<s16>(static_cast<s32>(rounded));
+}
+
+constexpr bool FitsIn(double value, int fractional_bits) {
+    const double scaled = value * static_cast<double>(1 << fractional_bits);
+    return scaled > -32768.5 && scaled < 32767.5;
+}
+
+/// Normalised angular frequency and the cookbook's alpha for a given Q.
+struct Prewarp {
+    double cos_w0;
+    double sin_w0;
+    double alpha;
+};
+
+constexpr Prewarp Warp(double frequency, double q, double sample_rate) {
+    const double w0 = 2.0 * pi * frequency / sample_rate;
+    const double sin_w0 = Sin(w0);
+    return {Cos(w0), sin_w0, sin_w0 / (2.0 * q)};
+}
+
+constexpr Biquad Normalise(double b0, double b1, double b2, double a0, double a1, double a2) {
+    return {b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+}
+
+} // namespace detail
+
+// First-order designs
+
+/// One-pole lowpass with unity gain at DC.
+constexpr OnePole OnePoleLowPass(double cutoff, double sample_rate = native_sample_rate) {
+    const double a1 = detail::Exp(-2.0 * detail::pi * cutoff / sample_rate);
+    return {1.0 - a1, a1};
+}
+
+// Second-order designs
+
+constexpr Biquad LowPass(double cutoff, double q, double sample_rate = native_sample_rate) {
+    const detail::Prewarp p = detail::Warp(cutoff, q, sample_rate);
+    const double b1 = 1.0 - p.cos_w0;
+    return detail::Normalise(b1 / 2.0, b1, b1 / 2.0, 1.0 + p.alpha, -2.0 * p.cos_w0, 1.0 - p.alpha);
+}
+
+constexpr Biquad HighPass(double cutoff, double q, double sample_rate = native_sample_rate) {
+    const detail::Prewarp p = detail::Warp(cutoff, q, sample_rate);
+    const double b1 = -(1.0 + p.cos_w0);
+    return detail::Normalise(-b1 / 2.0, b1, -b1 / 2.0, 1.0 + p.alpha, -2.0 * p.cos_w0, 1.0 - p.alpha);
+}
+
+/// Bandpass with 0 dB gain at the centre frequency.
+constexpr Biquad BandPass(double centre, double q, double sample_rate = native_sample_rate) {
+    const detail::Prewarp p = detail::Warp(centre, q, sample_rate);
+    return detail::Normalise(p.alpha, 0.0, -p.alpha, 1.0 + p.alpha, -2.0 * p.cos_w0, 1.0 - p.alpha);
+}
+
+constexpr Biquad Peaking(double centre, double q, double gain_db, double sample_rate = native_sample_rate) {
+    const detail::Prewarp p = detail::Warp(centre, q, sample_rate);
+    const double A = detail::ShelfAmplitude(gain_db);
+    return detail::Normalise(1.0 + p.alpha * A, -2.0 * p.cos_w0, 1.0 - p.alpha * A,
+                             1.0 + p.alpha / A, -2.0 * p.cos_w0, 1.0 - p.alpha / A);
+}
+
+/// Low shelf. `q` sets the transition steepness; 0.7071 gives the steepest monotonic slope.
+constexpr Biquad LowShelf(double corner, double q, double gain_db, double sample_rate = native_sample_rate) {
+    const detail::Prewarp p = detail::Warp(corner, q, sample_rate);
+    const double A = detail::ShelfAmplitude(gain_db);
+    const double k = 2.0 * detail::Sqrt(A) * p.alpha;
+    return detail::Normalise(A * ((A + 1.0) - (A - 1.0) * p.cos_w0 + k),
+                             2.0 * A * ((A - 1.0) - (A + 1.0) * p.cos_w0),
+                             A * ((A + 1.0) - (A - 1.0) * p.cos_w0 - k),
+                             (A + 1.0) + (A - 1.0) * p.cos_w0 + k,
+                             -2.0 * ((A - 1.0) + (A + 1.0) * p.cos_w0),
+                             (A + 1.0) + (A - 1.0) * p.cos_w0 - k);
+}
+
+constexpr Biquad HighShelf(double corner, double q, double gain_db, double sample_rate = native_sample_rate) {
+    const detail::Prewarp p = detail::Warp(corner, q, sample_rate);
+    const double A = detail::ShelfAmplitude(gain_db);
+    const double k = 2.0 * detail::Sqrt(A) * p.alpha;
+    return detail::Normalise(A * ((A + 1.0) + (A - 1.0) * p.cos_w0 + k),
+                             -2.0 * A * ((A - 1.0) + (A + 1.0) * p.cos_w0),
+                             A * ((A + 1.0) + (A - 1.0) * p.cos_w0 - k),
+                             (A + 1.0) - (A - 1.0) * p.cos_w0 + k,
+                             2.0 * ((A - 1.0) - (A + 1.0) * p.cos_w0),
+                             (A + 1.0) - (A - 1.0) * p.cos_w0 - k);
+}
+
+// Quantization
+
+/// Whether every coefficient fits the register format. Out-of-range coefficients saturate.
+constexpr bool IsRepresentable(const OnePole& design) {
+    return detail::FitsIn(design.b0, 15) && detail::FitsIn(design.a1, 15);
+}
+
+constexpr bool IsRepresentable(const Biquad& design) {
+    return detail::FitsIn(design.b0, 14) && detail::FitsIn(design.b1, 14) && detail::FitsIn(design.b2, 14) &&
+           detail::FitsIn(design.a1, 14) && detail::FitsIn(design.a2, 14);
+}
+
+constexpr SimpleFilter Quantize(const OnePole& design) {
+    return {detail::QuantizeTo(design.b0, 15), detail::QuantizeTo(design.a1, 15)};
+}
+
+/// Converts to Q14, negating the feedback coefficients as the DSP expects.
+constexpr BiquadFilter Quantize(const Biquad& design) {
+    BiquadFilter ret{};
+    ret.a2 = detail::QuantizeTo(-design.a2, 14);
+    ret.a1 = detail::QuantizeTo(-design.a1, 14);
+    ret.b2 = detail::QuantizeTo(design.b2, 14);
+    ret.b1 = detail::QuantizeTo(design.b1, 14);
+    ret.b0 = detail::QuantizeTo(design.b0, 14);
+    return ret;
+}
+
+constexpr OnePole Dequantize(const SimpleFilter& filter) {
+    return {filter.b0 / 32768.0, filter.a1 / 32768.0};
+}
+
+constexpr Biquad Dequantize(const BiquadFilter& filter) {
+    return {filter.b0 / 16384.0, filter.b1 / 16384.0, filter.b2 / 16384.0, -filter.a1 / 16384.0, -filter.a2 / 16384.0};
+}
+
+/// Whether the quantized pole lies strictly inside the unit circle. Q15 covers [-1, 1), so only
+/// a1 = -1 is on it.
+constexpr bool IsStable(const SimpleFilter& filter) {
+    return filter.a1 != -32768;
+}
+
+/// Whether both quantized poles lie strictly inside the unit circle (the stability triangle
+/// |a2| < 1, |a1| < 1 + a2, evaluated exactly on the integer coefficients).
+constexpr bool IsStable(const BiquadFilter& filter) {
+    // Standard notation: a1 = -filter.a1, a2 = -filter.a2, scaled by 2^14.
+    const s32 a1 = -static_cast<s32>(filter.a1);
+    const s32 a2 = -static_cast<s32>(filter.a2);
+    const s32 one = 1 << 14;
+    return a2 < one && a2 > -one && (a1 < 0 ? -a1 : a1) < one + a2;
+}
+
+// Frequency response
+
+/**
+ * Evaluates the magnitude response of the quantized filter at `count` frequencies, four at a
+ * time. This is the response the DSP realises, including quantization error.
+ */
+void MagnitudeResponse(const SimpleFilter& filter, const float* frequencies, float* magnitudes, size_t count,
+                       double sample_rate = native_sample_rate);
+void MagnitudeResponse(const BiquadFilter& filter, const float* frequencies, float* magnitudes, size_t count,
+                       double sample_rate = native_sample_rate);
+
+} // namespace FilterDesign
+} // namespace HLE
+} // namespace DSP
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__ARM_FEATURE_SAT)
+#include <arm_acle.h>
+#endif
+
+#include "common_funcs.h"
+#include "common_types.h"
+
+// Fixed-point arithmetic shared by the DSP kernels.
+//
+// Coefficients are 16-bit values with a fixed number of fractional bits, named after the format
+// the DSP uses them in: Q15 (simple filter), Q14 (biquad filter), Q11 (ADPCM predictor) and Q7
+// (delay effect). Products are summed in an Accumulator of the same format and are saturated once
+// when the result is stored. The sum is 64 bits wide, standing in for the DSP's 40-bit
+// accumulators, except in the simple filter, ADPCM predictor and polyphase kernel, which sum in 32
+// bits as AudioTest-SimpleFilter models the simple filter.
+//
+// On ARMv6 the 32-bit to 16-bit saturation maps onto SSAT. Its vector form is SIMD::PackSaturate
+// (packs on SSE2, qmovn on NEON, SaturateS16 per lane on the ARM11), the only saturating vector
+// operation the engine needs. The kernels using Accumulator are recursive or gather their input,
+// so they run one sample at a time, and no kernel adds 16-bit samples, the one thing the ARM11's
+// qadd16 would speed up. The mixers stay in float: gains and volumes arrive as float, and no
+// hardware capture yet shows which fixed-point format the DSP converts them to.
+
+namespace DSP {
+namespace HLE {
+
+FORCE_INLINE s16 SaturateS16(s32 value) {
+#if defined(__ARM_FEATURE_SAT)
+    return static_cast<s16>(__ssat(value, 16));
+#else
+    return static_cast<s16>(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value);
+#endif
+}
+
+FORCE_INLINE s16 SaturateS16(s64 value) {
+    return static_cast<s16>(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value);
+}
+
+FORCE_INLINE s32 SaturateS32(s64 value) {
+    return static_cast<s32>(value > INT32_MAX ? INT32_MAX : value < INT32_MIN ? INT32_MIN : value);
+}
+
+/// A 16-bit coefficient with `fractional_bits` fractional bits.
+template <unsigned fractional_bits_>
+struct Fixed16 {
+    static constexpr unsigned fractional_bits = fractional_bits_;
+    static_assert(fractional_bits < 16, "Fixed16 holds at most 15 fractional bits");
+
+    s16 raw;
+
+    static constexpr Fixed16 FromRaw(s16 raw) {
+        return {raw};
+    }
+
+    constexpr double ToDouble() const {
+        return static_cast<double>(raw) / (1 << fractional_bits);
+    }
+};
+
+using Q15 = Fixed16<15>;
+using Q14 = Fixed16<14>;
+using Q11 = Fixed16<11>;
+using Q7 = Fixed16<7>;
+
+/**
+ * Sum of products of Fixed16<fractional_bits> coefficients with integer samples. `Sum` is s64 or
+ * s32; a 32-bit sum wraps on overflow, as the 32-bit adds it reproduces do.
+ */
+template <unsigned fractional_bits, typename Sum = s64>
+class Accumulator {
+public:
+    constexpr Accumulator() = default;
+
+    /// Starts the sum at an integer value.
+    static constexpr Accumulator FromInteger(s64 value) {
+        return FromRaw(value * (s64{1} << fractional_bits));
+    }
+
+    /// Starts the sum at a value already in this format.
+    static constexpr Accumulator FromRaw(s64 raw) {
+        Accumulator ret;
+        ret.value = static_cast<Sum>(raw);
+        return ret;
+    }
+
+    FORCE_INLINE void MulAdd(Fixed16<fractional_bits> coefficient, s32 sample) {
+        value = static_cast<Sum>(value + static_cast<s64>(coefficient.raw) * sample);
+    }
+
+    FORCE_INLINE void MulSub(Fixed16<fractional_bits> coefficient, s32 sample) {
+        value = static_cast<Sum>(value - static_cast<s64>(coefficient.raw) * sample);
+    }
+
+    /// Adds one half, so that the next Saturate rounds to nearest instead of down.
+    FORCE_INLINE void AddHalf() {
+        value = static_cast<Sum>(value + (s64{1} << (fractional_bits - 1)));
+    }
+
+    /// Shifts out the fraction (rounding towards negative infinity) and saturates.
+    FORCE_INLINE s16 Saturate() const {
+        return SaturateS16(value >> fractional_bits);
+    }
+
+    FORCE_INLINE s32 Saturate32() const {
+        return SaturateS32(value >> fractional_bits);
+    }
+
+    constexpr Sum Raw() const {
+        return value;
+    }
+
+private:
+    Sum value = 0;
+};
+
+} // namespace HLE
+} // namespace DSP
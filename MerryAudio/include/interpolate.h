@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+
+#include "common_types.h"
+#include "dsp.h"
+
+namespace DSP {
+namespace HLE {
+namespace AudioInterp {
+
+/**
+ * The interpolators read from a staging buffer holding, per channel, the last `history_size` input
+ * samples of the previous frame followed by the new input for this frame. The resampling position
+ * is kept in 16.16 fixed point. Output sample i reads around staging index (position >> 16) + 2,
+ * which reproduces the two-sample delay observed on hardware (see AudioTest-InterpLinear).
+ */
+constexpr size_t history_size = 4;
+
+/// Fixed point format of rate_multiplier and the resampling position.
+constexpr unsigned position_bits = 16;
+
+/// Largest rate modelled, in 16.16. Higher rates are clamped.
+constexpr u32 max_rate = 16 << position_bits;
+
+constexpr size_t max_input_per_frame = AudioCore::samples_per_frame * (max_rate >> position_bits);
+/// One sample beyond the frame's input is staged for the polyphase kernel, see polyphase_window.
+constexpr size_t lookahead_size = 1;
+constexpr size_t staging_size = history_size + max_input_per_frame + lookahead_size;
+
+/// Per-channel staging buffers shared by all sources.
+using StagingBuffer = std::array<std::array<s16, staging_size>, 2>;
+
+/// Converts SourceConfiguration::rate_multiplier to 16.16, clamped to the modelled range.
+u32 RateToFixed(float rate_multiplier);
+
+/// Number of new input samples a frame consumes, starting at fractional position `fraction`.
+constexpr u32 InputSamplesNeeded(u32 fraction, u32 rate) {
+    return (fraction + rate * static_cast<u32>(AudioCore::samples_per_frame)) >> position_bits;
+}
+
+/// Staging samples a kernel reads for each output: `taps` samples from (position >> 16) + first.
+struct KernelWindow {
+    u32 first;
+    u32 taps;
+};
+
+constexpr KernelWindow none_window{2, 1};
+constexpr KernelWindow linear_window{2, 2};
+/// Centred on the same point as linear_window, so the last tap can fall on the sample after the
+/// frame's input. That sample is staged without being consumed (see lookahead_size).
+constexpr KernelWindow polyphase_window{1, 4};
+
+/// Repeats the sample at the current position.
+void None(const s16* staging, u32 fraction, u32 rate, s16* out);
+
+/// Linear interpolation between neighbouring samples, as measured by AudioTest-InterpLinear.
+void Linear(const s16* staging, u32 fraction, u32 rate, s16* out);
+
+/**
+ * Four-tap polyphase interpolation. `coefficient_set` is interpolation_related (0-3).
+ *
+ * The hardware coefficients have not been captured yet (see AudioTest-InterpPolyphase-Impulse), so
+ * the four sets are windowed-sinc kernels with decreasing cutoff. This path is not bit-exact.
+ */
+void Polyphase(const s16* staging, u32 fraction, u32 rate, unsigned coefficient_set, s16* out);
+
+// Float kernels for the preview pipeline. They read the same input positions and use the same
+// polyphase kernels, but skip rounding and saturation and compute four outputs at a time.
+
+void NonePreview(const s16* staging, u32 fraction, u32 rate, float* out);
+void LinearPreview(const s16* staging, u32 fraction, u32 rate, float* out);
+void PolyphasePreview(const s16* staging, u32 fraction, u32 rate, unsigned coefficient_set, float* out);
+
+} // namespace AudioInterp
+} // namespace HLE
+} // namespace DSP
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+
+#include "common_types.h"
+#include "dsp.h"
+#include "hle_common.h"
+
+namespace DSP {
+namespace HLE {
+
+/**
+ * Dynamics stage applied to the downmixed output before it is saturated to PCM16.
+ *
+ * A peak envelope follower (instant attack, exponential release) drives a gain that is looked up
+ * in a precomputed curve, so the per-sample cost is one table load and one multiply. The curve is
+ * rebuilt only when the application marks the limiter configuration dirty.
+ */
+class Limiter {
+public:
+    /**
+     * Re-reads the limiter configuration. Call this only when limiter_enabled_dirty is set.
+     *
+     * The layout of the Compressor table is not known yet (see dsp.h), so the table is not decoded;
+     * the curve is a hard-knee limiter with a fixed ceiling just below full scale. Once the table is
+     * understood only BuildGainCurve needs to change.
+     */
+    void Configure(const DspConfiguration& config, const Compressor& compressor);
+
+    /// Forgets the envelope. The configuration is kept.
+    void Reset();
+
+    /// Turns the limiter off and forgets the envelope, as before the first Configure.
+    void Disable();
+
+    /// Applies the limiter to a frame in place. Does nothing when the limiter is disabled.
+    void Process(StereoFrame32& frame);
+
+    bool IsEnabled() const {
+        return enabled;
+    }
+
+private:
+    void BuildGainCurve(const Compressor& compressor);
+
+    /// Envelope values are quantised by this shift to index the gain curve.
+    static constexpr unsigned curve_shift = 9;
+    static constexpr size_t curve_size = 1024;
+
+    bool enabled = false;
+    float envelope = 0.0f;
+    float ceiling = 0.0f;
+    float release = 0.0f;
+    std::array<float, curve_size> gain_curve{};
+};
+
+} // namespace HLE
+} // namespace DSP
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+
+#include "common_types.h"
+#include "dsp.h"
+#include "fixed_point.h"
+#include "hle_common.h"
+#include "limiter.h"
+
+namespace DSP {
+namespace HLE {
+
+/**
+ * The delay effect of an auxiliary mixer. See DspConfiguration::DelayEffect for the transfer function.
+ *
+ * Rewriting the transfer function as y[n] = w[n-N] + b y[n-1], with w[n] = a x[n] - a g y[n], means
+ * only one delay line per channel is needed.
+ */
+class DelayEffect {
+public:
+    /// Longest delay that is modelled. Longer delays are clamped to this.
+    static constexpr size_t max_frames = 16;
+
+    /// Clears the delay line. The configuration is kept.
+    void Reset();
+    void Configure(const DspConfiguration::DelayEffect& config);
+    /// Replaces the contents of the mixer with the output of the effect.
+    void Process(QuadFrame32& mix);
+
+    bool IsEnabled() const {
+        return enabled;
+    }
+
+private:
+    static constexpr size_t max_length = max_frames * AudioCore::samples_per_frame;
+
+    bool enabled = false;
+    Q7 g{};
+    Q7 a{};
+    Q7 b{};
+    u32 length = AudioCore::samples_per_frame;
+    u32 position = 0;
+    std::array<s16, 4> previous{};
+    std::array<std::array<s32, max_length>, 4> line{};
+};
+
+/**
+ * Final mixing stage: applies the auxiliary effects and the per-mixer volume, downmixes the three
+ * intermediate mixers to the configured output format, limits, and saturates to PCM16.
+ */
+class Mixers {
+public:
+    /// Signature of a specialized downmix of one intermediate mixer into the stereo accumulator.
+    using DownmixFn = void (*)(const QuadFrame32& mix, float volume, StereoFrame32& accumulator);
+
+    Mixers();
+
+    /// Returns to the state of a new Mixers: default configuration, effects and limiter off.
+    void Reset();
+
+    /// Applies the fields flagged dirty in config and clears its dirty flags, as the DSP does.
+    void ParseConfig(DspConfiguration& config, const Compressor& compressor);
+
+    /**
+     * Mixes one frame.
+     * @param intermediate_mixes The three intermediate mixers. The auxiliary mixers (1 and 2) are
+     *                           overwritten with their effect output.
+     * @param final_samples Receives the interleaved PCM16 output.
+     */
+    void Tick(std::array<QuadFrame32, 3>& intermediate_mixes, FinalMixSamples& final_samples);
+
+private:
+    /// Re-selects the downmix specializations. Called when the output format or the partial
+    /// surround flags change, never per sample.
+    void SelectDownmix();
+
+    /// The downmix specializations, indexed by `downmix`.
+    static const std::array<DownmixFn, 3> downmix_table;
+
+    DspConfiguration::OutputFormat output_format = DspConfiguration::OutputFormat::Stereo;
+    std::array<float, 3> volume{};
+    std::array<bool, 3> mixer_enabled{{true, false, false}};
+    std::array<bool, 2> partial_surround{};
+
+    /// Selected downmix per mixer. An index rather than a pointer, so the state holds no addresses.
+    std::array<u8, 3> downmix{};
+    std::array<DelayEffect, 2> delay_effect;
+    Limiter limiter;
+};
+
+} // namespace HLE
+} // namespace DSP
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+
+#include "common_funcs.h"
+#include "common_types.h"
+
+/**
+ * Scoped timers around the stages of the pipeline, for seeing where a frame's time goes.
+ *
+ * Timers are compiled in only when DSP_PROFILE is defined; otherwise the PROFILE_ macros expand
+ * to nothing and the pipeline carries no trace of them. Each scope reads the cycle counter on entry
+ * and exit and appends one event to a ring owned by the calling thread, so recording takes no
+ * locks and allocates nothing. Each ring keeps the most recent ring_capacity events.
+ *
+ * The counter is svcGetSystemTick on the 3DS, the time stamp counter on x86, the virtual counter
+ * on AArch64, and steady_clock elsewhere.
+ *
+ * WriteChromeTrace exports the events as trace-event JSON for chrome://tracing or Perfetto. Scopes
+ * nest, so each frame shows up as a flame graph: the frame, each source within it and the stages
+ * within each source.
+ */
+namespace DSP {
+namespace HLE {
+namespace Profiler {
+
+enum class Stage : u8 {
+    Frame,       ///< One call to Engine::Tick, or one batch of Engine::Render.
+    Source,      ///< One source for one frame.
+    Queue,       ///< Configuration parsing, buffer queue bookkeeping and status.
+    Decode,      ///< Fetching and decoding input, or skipping over it.
+    Interpolate, ///< Resampling.
+    Filter,      ///< Simple and biquad filters.
+    Mix,         ///< Mixing a source into the intermediate mixes.
+    Effects,     ///< Delay effects on the auxiliary mixes.
+    FinalMix,    ///< Downmix, limiter and conversion to PCM16.
+    Count,
+};
+
+const char* StageName(Stage stage);
+
+/// Events kept per thread, about 200 frames of a busy engine.
+constexpr size_t ring_capacity = 32768;
+/// Threads that can record. Events of further threads are dropped.
+constexpr size_t max_threads = 4;
+/// Source of events recorded outside any source.
+constexpr u8 no_source = 0xFF;
+
+struct Event {
+    u64 begin;    ///< Counter ticks.
+    u32 duration; ///< Counter ticks.
+    u32 frame;    ///< Frame set with SetFrame when the scope was entered.
+    Stage stage;
+    u8 source;
+};
+
+/// Reads the cycle counter.
+u64 Now();
+
+/// Sets the frame that the calling thread's following events belong to.
+void SetFrame(u32 frame);
+
+/// Times the enclosing block. A scope given a source also tags the scopes nested in it.
+class Scope {
+public:
+    explicit Scope(Stage stage, u8 source = no_source);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    u64 begin;
+    u32 frame;
+    Stage stage;
+    u8 outer_source; ///< Source of the enclosing scopes, restored on exit.
+};
+
+/**
+ * Writes every recorded event as trace-event JSON, one process with one track per thread. Call it
+ * while no profiled thread is running, since the rings are read without synchronization.
+ * @return The number of events written. Always 0 in builds without DSP_PROFILE.
+ */
+size_t WriteChromeTrace(std::FILE* file);
+
+/// Calls `visit(thread, event)` for every recorded event, oldest first within each thread. Same
+/// caveat as WriteChromeTrace.
+void ForEachEvent(const std::function<void(size_t thread, const Event& event)>& visit);
+
+/// Counter ticks per second, measured against steady_clock since the first recorded event.
+double TicksPerSecond();
+
+/// Forgets every recorded event. Same caveat as WriteChromeTrace.
+void Clear();
+
+} // namespace Profiler
+} // namespace HLE
+} // namespace DSP
+
+/// Times the rest of the enclosing block as `stage`, a Profiler::Stage enumerator.
+#if defined(DSP_PROFILE)
+#define PROFILE_SCOPE(stage) \
+    const ::DSP::HLE::Profiler::Scope CONCAT2(profile_scope_, __LINE__)(::DSP::HLE::Profiler::Stage::stage)
+#define PROFILE_SOURCE_SCOPE(source) \
+    const ::DSP::HLE::Profiler::Scope CONCAT2(profile_scope_, __LINE__)(::DSP::HLE::Profiler::Stage::Source, static_cast<u8>(source))
+#define PROFILE_FRAME(frame) ::DSP::HLE::Profiler::SetFrame(frame)
+#else
+#define PROFILE_SCOPE(stage) ((void)0)
+#define PROFILE_SOURCE_SCOPE(source) ((void)0)
+#define PROFILE_FRAME(frame) ((void)0)
+#endif
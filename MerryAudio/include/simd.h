@@ -0,0 +1,288 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "common_funcs.h"
+#include "common_types.h"
+#include "fixed_point.h"
+
+// Thin wrappers over the vector units available on the platforms this library runs on.
+//
+// Host builds use SSE2 (always present on x86-64) or NEON (AArch64, and 32-bit ARM hosts that
+// have it). The ARM11 in the 3DS has
+// neither, so device builds fall back to plain four-wide loops that the compiler maps onto VFP.
+// Defining SIMD_FORCE_SCALAR selects the fallback on any platform, which is useful to check that
+// a vectorized kernel is bit-identical to its scalar form.
+
+#if defined(__SSE2__) && !defined(SIMD_FORCE_SCALAR)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && !defined(SIMD_FORCE_SCALAR)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define SIMD_SCALAR 1
+#endif
+
+namespace SIMD {
+
+/// Number of 32-bit lanes in a vector.
+constexpr size_t lanes = 4;
+
+#if defined(SIMD_SSE2)
+
+struct F32x4 { __m128 v; };
+struct S32x4 { __m128i v; };
+struct S16x8 { __m128i v; };
+struct S8x16 { __m128i v; };
+
+FORCE_INLINE F32x4 Load(const float* p) { return {_mm_loadu_ps(p)}; }
+FORCE_INLINE S32x4 Load(const s32* p) { return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))}; }
+FORCE_INLINE void Store(float* p, F32x4 a) { _mm_storeu_ps(p, a.v); }
+FORCE_INLINE void Store(s32* p, S32x4 a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a.v); }
+
+FORCE_INLINE F32x4 Splat(float x) { return {_mm_set1_ps(x)}; }
+FORCE_INLINE S32x4 Splat(s32 x) { return {_mm_set1_epi32(x)}; }
+
+FORCE_INLINE F32x4 operator+(F32x4 a, F32x4 b) { return {_mm_add_ps(a.v, b.v)}; }
+FORCE_INLINE F32x4 operator-(F32x4 a, F32x4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+FORCE_INLINE F32x4 operator*(F32x4 a, F32x4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+FORCE_INLINE F32x4 operator/(F32x4 a, F32x4 b) { return {_mm_div_ps(a.v, b.v)}; }
+FORCE_INLINE F32x4 Sqrt(F32x4 a) { return {_mm_sqrt_ps(a.v)}; }
+FORCE_INLINE S32x4 operator+(S32x4 a, S32x4 b) { return {_mm_add_epi32(a.v, b.v)}; }
+
+FORCE_INLINE F32x4 Min(F32x4 a, F32x4 b) { return {_mm_min_ps(a.v, b.v)}; }
+FORCE_INLINE F32x4 Max(F32x4 a, F32x4 b) { return {_mm_max_ps(a.v, b.v)}; }
+
+/// Converts to float. Exact for magnitudes below 2^24.
+FORCE_INLINE F32x4 ToFloat(S32x4 a) { return {_mm_cvtepi32_ps(a.v)}; }
+/// Converts to integer, rounding towards zero like static_cast<s32>.
+FORCE_INLINE S32x4 Truncate(F32x4 a) { return {_mm_cvttps_epi32(a.v)}; }
+
+FORCE_INLINE void Store(s16* p, S16x8 a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a.v); }
+/// Loads four 16-bit values and sign-extends them to 32 bits.
+FORCE_INLINE S32x4 LoadWiden(const s16* p) {
+    const __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+    return {_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)};
+}
+/// Saturates eight 32-bit values to 16 bits: lo supplies lanes 0-3, hi lanes 4-7.
+FORCE_INLINE S16x8 PackSaturate(S32x4 lo, S32x4 hi) { return {_mm_packs_epi32(lo.v, hi.v)}; }
+/// Interleaves lanes 0-3 of a and b: a0 b0 a1 b1 a2 b2 a3 b3.
+FORCE_INLINE S16x8 InterleaveLow(S16x8 a, S16x8 b) { return {_mm_unpacklo_epi16(a.v, b.v)}; }
+/// Interleaves lanes 4-7 of a and b: a4 b4 a5 b5 a6 b6 a7 b7.
+FORCE_INLINE S16x8 InterleaveHigh(S16x8 a, S16x8 b) { return {_mm_unpackhi_epi16(a.v, b.v)}; }
+
+FORCE_INLINE S16x8 Load(const s16* p) { return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))}; }
+FORCE_INLINE S8x16 Load(const s8* p) { return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))}; }
+/// Widens lanes 0-7 to 16 bits, scaled by 256 (PCM8 to PCM16).
+FORCE_INLINE S16x8 ExpandLow(S8x16 a) { return {_mm_unpacklo_epi8(_mm_setzero_si128(), a.v)}; }
+/// Widens lanes 8-15 to 16 bits, scaled by 256 (PCM8 to PCM16).
+FORCE_INLINE S16x8 ExpandHigh(S8x16 a) { return {_mm_unpackhi_epi8(_mm_setzero_si128(), a.v)}; }
+/// Splits a0 a1 ... a7 b0 ... b7 into its even lanes (a0 a2 ... b6) and odd lanes (a1 a3 ... b7).
+FORCE_INLINE void Deinterleave(S16x8 a, S16x8 b, S16x8& even, S16x8& odd) {
+    // Sign-extending each 32-bit pair from its low or high half keeps packs_epi32 from saturating.
+    even.v = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a.v, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b.v, 16), 16));
+    odd.v = _mm_packs_epi32(_mm_srai_epi32(a.v, 16), _mm_srai_epi32(b.v, 16));
+}
+
+#elif defined(SIMD_NEON)
+
+struct F32x4 { float32x4_t v; };
+struct S32x4 { int32x4_t v; };
+struct S16x8 { int16x8_t v; };
+struct S8x16 { int8x16_t v; };
+
+FORCE_INLINE F32x4 Load(const float* p) { return {vld1q_f32(p)}; }
+FORCE_INLINE S32x4 Load(const s32* p) { return {vld1q_s32(p)}; }
+FORCE_INLINE void Store(float* p, F32x4 a) { vst1q_f32(p, a.v); }
+FORCE_INLINE void Store(s32* p, S32x4 a) { vst1q_s32(p, a.v); }
+
+FORCE_INLINE F32x4 Splat(float x) { return {vdupq_n_f32(x)}; }
+FORCE_INLINE S32x4 Splat(s32 x) { return {vdupq_n_s32(x)}; }
+
+FORCE_INLINE F32x4 operator+(F32x4 a, F32x4 b) { return {vaddq_f32(a.v, b.v)}; }
+FORCE_INLINE F32x4 operator-(F32x4 a, F32x4 b) { return {vsubq_f32(a.v, b.v)}; }
+FORCE_INLINE F32x4 operator*(F32x4 a, F32x4 b) { return {vmulq_f32(a.v, b.v)}; }
+#if defined(__aarch64__)
+FORCE_INLINE F32x4 operator/(F32x4 a, F32x4 b) { return {vdivq_f32(a.v, b.v)}; }
+FORCE_INLINE F32x4 Sqrt(F32x4 a) { return {vsqrtq_f32(a.v)}; }
+#else
+// 32-bit NEON only has reciprocal and square root estimates, so these go lane by lane to stay
+// correctly rounded like the other backends. Only the filter magnitude responses use them.
+FORCE_INLINE F32x4 operator/(F32x4 a, F32x4 b) {
+    float x[lanes], y[lanes];
+    vst1q_f32(x, a.v);
+    vst1q_f32(y, b.v);
+    for (size_t i = 0; i < lanes; i++)
+        x[i] /= y[i];
+    return {vld1q_f32(x)};
+}
+FORCE_INLINE F32x4 Sqrt(F32x4 a) {
+    float x[lanes];
+    vst1q_f32(x, a.v);
+    for (size_t i = 0; i < lanes; i++)
+        x[i] = std::sqrt(x[i]);
+    return {vld1q_f32(x)};
+}
+#endif
+FORCE_INLINE S32x4 operator+(S32x4 a, S32x4 b) { return {vaddq_s32(a.v, b.v)}; }
+
+FORCE_INLINE F32x4 Min(F32x4 a, F32x4 b) { return {vminq_f32(a.v, b.v)}; }
+FORCE_INLINE F32x4 Max(F32x4 a, F32x4 b) { return {vmaxq_f32(a.v, b.v)}; }
+
+FORCE_INLINE F32x4 ToFloat(S32x4 a) { return {vcvtq_f32_s32(a.v)}; }
+FORCE_INLINE S32x4 Truncate(F32x4 a) { return {vcvtq_s32_f32(a.v)}; }
+
+FORCE_INLINE void Store(s16* p, S16x8 a) { vst1q_s16(p, a.v); }
+FORCE_INLINE S32x4 LoadWiden(const s16* p) { return {vmovl_s16(vld1_s16(p))}; }
+FORCE_INLINE S16x8 PackSaturate(S32x4 lo, S32x4 hi) { return {vcombine_s16(vqmovn_s32(lo.v), vqmovn_s32(hi.v))}; }
+FORCE_INLINE S16x8 InterleaveLow(S16x8 a, S16x8 b) { return {vzipq_s16(a.v, b.v).val[0]}; }
+FORCE_INLINE S16x8 InterleaveHigh(S16x8 a, S16x8 b) { return {vzipq_s16(a.v, b.v).val[1]}; }
+
+FORCE_INLINE S16x8 Load(const s16* p) { return {vld1q_s16(p)}; }
+FORCE_INLINE S8x16 Load(const s8* p) { return {vld1q_s8(p)}; }
+FORCE_INLINE S16x8 ExpandLow(S8x16 a) { return {vshll_n_s8(vget_low_s8(a.v), 8)}; }
+FORCE_INLINE S16x8 ExpandHigh(S8x16 a) { return {vshll_n_s8(vget_high_s8(a.v), 8)}; }
+FORCE_INLINE void Deinterleave(S16x8 a, S16x8 b, S16x8& even, S16x8& odd) {
+    const int16x8x2_t split = vuzpq_s16(a.v, b.v);
+    even.v = split.val[0];
+    odd.v = split.val[1];
+}
+
+#else
+
+struct F32x4 { float v[lanes]; };
+struct S32x4 { s32 v[lanes]; };
+struct S16x8 { s16 v[2 * lanes]; };
+struct S8x16 { s8 v[4 * lanes]; };
+
+template <typename T, typename V>
+FORCE_INLINE V LoadLanes(const T* p) {
+    V ret;
+    for (size_t i = 0; i < lanes; i++)
+        ret.v[i] = p[i];
+    return ret;
+}
+
+template <typename T, typename V>
+FORCE_INLINE void StoreLanes(T* p, const V& a) {
+    for (size_t i = 0; i < lanes; i++)
+        p[i] = a.v[i];
+}
+
+template <typename V, typename Op>
+FORCE_INLINE V MapLanes(const V& a, const V& b, Op op) {
+    V ret;
+    for (size_t i = 0; i < lanes; i++)
+        ret.v[i] = op(a.v[i], b.v[i]);
+    return ret;
+}
+
+FORCE_INLINE F32x4 Load(const float* p) { return LoadLanes<float, F32x4>(p); }
+FORCE_INLINE S32x4 Load(const s32* p) { return LoadLanes<s32, S32x4>(p); }
+FORCE_INLINE void Store(float* p, F32x4 a) { StoreLanes(p, a); }
+FORCE_INLINE void Store(s32* p, S32x4 a) { StoreLanes(p, a); }
+
+FORCE_INLINE F32x4 Splat(float x) { return {{x, x, x, x}}; }
+FORCE_INLINE S32x4 Splat(s32 x) { return {{x, x, x, x}}; }
+
+FORCE_INLINE F32x4 operator+(F32x4 a, F32x4 b) { return MapLanes(a, b, [](float x, float y) { return x + y; }); }
+FORCE_INLINE F32x4 operator-(F32x4 a, F32x4 b) { return MapLanes(a, b, [](float x, float y) { return x - y; }); }
+FORCE_INLINE F32x4 operator*(F32x4 a, F32x4 b) { return MapLanes(a, b, [](float x, float y) { return x * y; }); }
+FORCE_INLINE F32x4 operator/(F32x4 a, F32x4 b) { return MapLanes(a, b, [](float x, float y) { return x / y; }); }
+FORCE_INLINE F32x4 Sqrt(F32x4 a) { return MapLanes(a, a, [](float x, float) { return std::sqrt(x); }); }
+FORCE_INLINE S32x4 operator+(S32x4 a, S32x4 b) { return MapLanes(a, b, [](s32 x, s32 y) { return x + y; }); }
+
+FORCE_INLINE F32x4 Min(F32x4 a, F32x4 b) { return MapLanes(a, b, [](float x, float y) { return x < y ? x : y; }); }
+FORCE_INLINE F32x4 Max(F32x4 a, F32x4 b) { return MapLanes(a, b, [](float x, float y) { return x > y ? x : y; }); }
+
+FORCE_INLINE F32x4 ToFloat(S32x4 a) {
+    F32x4 ret;
+    for (size_t i = 0; i < lanes; i++)
+        ret.v[i] = static_cast<float>(a.v[i]);
+    return ret;
+}
+
+FORCE_INLINE S32x4 Truncate(F32x4 a) {
+    S32x4 ret;
+    for (size_t i = 0; i < lanes; i++)
+        ret.v[i] = static_cast<s32>(a.v[i]);
+    return ret;
+}
+
+FORCE_INLINE void Store(s16* p, S16x8 a) {
+    for (size_t i = 0; i < 2 * lanes; i++)
+        p[i] = a.v[i];
+}
+
+FORCE_INLINE S32x4 LoadWiden(const s16* p) { return LoadLanes<s16, S32x4>(p); }
+
+/// Saturates each lane with SaturateS16, which is SSAT on the ARM11.
+FORCE_INLINE S16x8 PackSaturate(S32x4 lo, S32x4 hi) {
+    S16x8 ret;
+    for (size_t i = 0; i < lanes; i++) {
+        ret.v[i] = DSP::HLE::SaturateS16(lo.v[i]);
+        ret.v[i + lanes] = DSP::HLE::SaturateS16(hi.v[i]);
+    }
+    return ret;
+}
+
+FORCE_INLINE S16x8 InterleaveLow(S16x8 a, S16x8 b) {
+    S16x8 ret;
+    for (size_t i = 0; i < lanes; i++) {
+        ret.v[2 * i] = a.v[i];
+        ret.v[2 * i + 1] = b.v[i];
+    }
+    return ret;
+}
+
+FORCE_INLINE S16x8 InterleaveHigh(S16x8 a, S16x8 b) {
+    S16x8 ret;
+    for (size_t i = 0; i < lanes; i++) {
+        ret.v[2 * i] = a.v[i + lanes];
+        ret.v[2 * i + 1] = b.v[i + lanes];
+    }
+    return ret;
+}
+
+FORCE_INLINE S16x8 Load(const s16* p) {
+    S16x8 ret;
+    for (size_t i = 0; i < 2 * lanes; i++)
+        ret.v[i] = p[i];
+    return ret;
+}
+
+FORCE_INLINE S8x16 Load(const s8* p) {
+    S8x16 ret;
+    for (size_t i = 0; i < 4 * lanes; i++)
+        ret.v[i] = p[i];
+    return ret;
+}
+
+FORCE_INLINE S16x8 ExpandLow(S8x16 a) {
+    S16x8 ret;
+    for (size_t i = 0; i < 2 * lanes; i++)
+        ret.v[i] = static_cast<s16>(a.v[i] * 256);
+    return ret;
+}
+
+FORCE_INLINE S16x8 ExpandHigh(S8x16 a) {
+    S16x8 ret;
+    for (size_t i = 0; i < 2 * lanes; i++)
+        ret.v[i] = static_cast<s16>(a.v[i + 2 * lanes] * 256);
+    return ret;
+}
+
+FORCE_INLINE void Deinterleave(S16x8 a, S16x8 b, S16x8& even, S16x8& odd) {
+    for (size_t i = 0; i < lanes; i++) {
+        even.v[i] = a.v[2 * i];
+        odd.v[i] = a.v[2 * i + 1];
+        even.v[i + lanes] = b.v[2 * i];
+        odd.v[i + lanes] = b.v[2 * i + 1];
+    }
+}
+
+#endif
+
+} // namespace SIMD
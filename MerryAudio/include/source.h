@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <utility>
+
+#include "buffer_queue.h"
+#include "codec.h"
+#include "common_types.h"
+#include "dsp.h"
+#include "filter.h"
+#include "hle_common.h"
+#include "interpolate.h"
+#include "source_mixer.h"
+
+namespace DSP {
+namespace HLE {
+
+/**
+ * One of the 24 sources of the DSP: decodes its buffers, resamples, filters, and mixes the result
+ * into the intermediate mixers.
+ *
+ * A frame pulls its input from the buffer queue as spans, decoding each span straight into the
+ * staging buffer behind the history kept from the previous frame, so the interpolator sees one
+ * contiguous run of input no matter how many buffers the frame crossed.
+ *
+ * The configuration is decoded from the wire struct only when its dirty flags fire. What a frame
+ * reads and writes is kept together at the start of the object, and each source starts on its own
+ * cache line. The output frame is scratch space owned by the caller, so it is shared by all
+ * sources rather than taking up room in each one.
+ */
+class alignas(cache_line_size) Source {
+public:
+    Source() {
+        Reset();
+    }
+
+    void Reset();
+
+    /// Applies the fields flagged dirty in config and clears its dirty flags, as the DSP does.
+    void ParseConfig(SourceConfiguration::Configuration& config, const s16_le (&adpcm_coeffs)[16]);
+
+    /**
+     * Produces the next frame of output.
+     *
+     * A source that cannot be heard is skipped: only its buffer positions, ADPCM predictor and
+     * interpolation history advance, so its status stays exact. A source is inaudible when all of
+     * its gains are zero and both filters are off, which leaves the output unchanged. If
+     * `silence_threshold` is non-zero, a source is also skipped when the peak of the last frame it
+     * rendered was below the threshold and no buffer has been queued or started since; it renders
+     * again every silence_recheck_frames frames to measure its level anew. Filter state is frozen
+     * while a source is skipped, so skipping below the threshold changes the output.
+     *
+     * @param memory Resolves buffer addresses.
+     * @param staging Scratch space, shared between sources.
+     * @param frame Receives the output. Scratch space, shared between sources.
+     * @param silence_threshold Peak sample value below which a source counts as silent, or 0 to
+     *                          skip only inaudible sources.
+     * @param skip_muted Whether inaudible sources are skipped. Skipping them does not change the
+     *                   output, so this is only turned off to check that.
+     * @return Whether the frame was skipped.
+     */
+    bool GenerateFrame(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging, StereoFrame16& frame,
+                       u16 silence_threshold = 0, bool skip_muted = true);
+
+    /// Accumulates the frame produced by the last GenerateFrame into the intermediate mixers.
+    void MixInto(const StereoFrame16& frame, std::array<QuadFrame32, 3>& mixes);
+
+    void WriteStatus(SourceStatus::Status& status);
+
+    /// Whether the source played during the last frame, including frames it skipped.
+    bool IsPlaying() const {
+        return playing;
+    }
+
+    /// Switches between the bit-exact and the float preview pipelines.
+    void SetPrecision(Precision precision);
+
+    /// Number of specialized pipelines: precision x format x channel layout x interpolation mode x filters.
+    static constexpr size_t num_pipelines = 2 * 3 * 2 * 3 * 4;
+
+private:
+    using Format = SourceConfiguration::Configuration::Format;
+    using InterpolationMode = SourceConfiguration::Configuration::InterpolationMode;
+    using PipelineFn = void (Source::*)(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging, StereoFrame16& frame);
+
+    /**
+     * Decodes, resamples and filters one frame. Every mode that can change between frames is a
+     * template parameter, so each instantiation is a straight-line pipeline with no mode checks.
+     */
+    template <bool preview, Format format, unsigned channels, InterpolationMode mode, bool simple_on, bool biquad_on>
+    void RunPipeline(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging, StereoFrame16& frame);
+
+    /**
+     * Decodes the input of the next frame into the staging buffer, behind the history.
+     * @return The number of new input samples, all of which are valid (zero past the queue).
+     */
+    template <Format format, unsigned channels>
+    u32 FetchInput(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging);
+
+    /**
+     * FetchInput for high rates: decodes only the runs of staging samples the `mode` kernel reads,
+     * and the next frame's history, leaving the rest of the staging buffer stale. PCM8 and stereo
+     * PCM16 only: ADPCM samples depend on every sample before them, and mono PCM16 is a plain copy
+     * that is cheaper in one run at any rate.
+     */
+    template <Format format, unsigned channels, InterpolationMode mode>
+    u32 FetchTouched(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging);
+
+    /// A source skipped below the silence threshold renders one frame after this many, about 40 ms,
+    /// so a quiet start that grows louder is heard.
+    static constexpr u8 silence_recheck_frames = 8;
+
+    /// Rate from which PCM input is fetched with FetchTouched. Below it, the kernels' windows
+    /// cover most of the input and decoding all of it in one run is cheaper.
+    static constexpr u32 sparse_fetch_rate = 8 << AudioInterp::position_bits;
+
+    /**
+     * Decodes the sample after the frame's `needed` input samples to the end of the staging buffer,
+     * for the last tap of the polyphase kernel. It is read from a copy of the queue: the sample,
+     * and the buffer it starts, belong to the next frame.
+     */
+    template <Format format, unsigned channels>
+    void FetchLookahead(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging, u32 needed);
+
+    /// Keeps the tail of the input as history and advances the resampling position.
+    void AdvancePosition(const AudioInterp::StagingBuffer& staging, u32 consumed, unsigned channels);
+
+    /// Decodes one span of input to `offset` samples past the history in the staging buffer.
+    template <Format format, unsigned channels>
+    void DecodeSpan(const MemoryTranslator& memory, const BufferQueue::Span& span, AudioInterp::StagingBuffer& staging, u32 offset);
+
+    /// Advances through one frame of input without producing output, see GenerateFrame.
+    template <Format format, unsigned channels>
+    void SkipPipeline(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging, StereoFrame16& frame);
+
+    /// Peak absolute sample of the frame, for the silence threshold.
+    u16 FramePeak(const StereoFrame16& frame) const;
+
+    template <size_t... indices>
+    static constexpr std::array<PipelineFn, num_pipelines> MakePipelineTable(std::index_sequence<indices...>);
+
+    /// Every pipeline, indexed as described in MakePipelineTable.
+    static const std::array<PipelineFn, num_pipelines> pipeline_table;
+    /// The skip pipelines, indexed by format * 2 + channels - 1.
+    static const std::array<PipelineFn, 6> skip_table;
+
+    /// Re-selects the pipeline. Called when a dirty flag affecting the choice fires, never per frame.
+    void SelectPipeline();
+
+    // Read or written every frame.
+
+    // The pipelines are held as table indices rather than pointers, so the state holds no
+    // addresses and a snapshot of it stays valid in another run of the same build.
+    u16 pipeline;
+    u8 skip_pipeline;
+
+    bool enabled;
+    bool playing;     ///< Whether the last frame produced output.
+    bool skipped;     ///< Whether the last frame was skipped, producing no output.
+    bool queue_event; ///< A buffer was queued or started since the last rendered frame.
+    u16 last_peak;    ///< Peak of the last rendered frame. Unknown (the maximum) after a muted frame.
+    u8 quiet_frames;  ///< Frames skipped in a row below the silence threshold.
+    u8 interpolation_related;
+    unsigned channels;
+
+    u32 rate;     ///< rate_multiplier in 16.16.
+    u32 fraction; ///< Fractional part of the resampling position.
+    /// The last input samples of the previous frame, per channel.
+    std::array<std::array<s16, AudioInterp::history_size>, 2> history;
+    Codec::AdpcmState adpcm_state;
+    std::array<s16, 16> adpcm_coeffs;
+
+    SourceFilters filters;
+    SourceMixer mixer;
+    /// Last, so the waiting buffers at its end follow everything else a frame touches.
+    BufferQueue queue;
+
+    // Only read when the configuration changes.
+
+    u16 sync;
+    Format format;
+    InterpolationMode interpolation_mode;
+    Precision precision = Precision::BitExact;
+};
+
+} // namespace HLE
+} // namespace DSP
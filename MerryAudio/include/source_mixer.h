@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+
+#include "common_types.h"
+#include "dsp.h"
+#include "hle_common.h"
+
+namespace DSP {
+namespace HLE {
+
+/**
+ * Mixes the output of one source into the three intermediate mixers.
+ *
+ * Gain changes made while the source is playing are spread over the next frame as a per-sample
+ * linear ramp instead of being applied as a step, and a source starting with fade_in ramps up from
+ * silence over its first frame. Both envelopes are evaluated inside the mixing loop itself, so
+ * smoothing costs no extra pass over the samples. Frames without a pending change take a path with
+ * constant gains.
+ */
+class SourceMixer {
+public:
+    void Reset();
+
+    /**
+     * Picks up the gains flagged by gain_0_dirty, gain_1_dirty and gain_2_dirty.
+     * @param playing Whether the source produced output last frame. Changes made to an idle source
+     *                take effect immediately since there is nothing to click.
+     */
+    void ParseConfig(const SourceConfiguration::Configuration& config, bool playing);
+
+    /// Ramps the output up from silence over the next frame.
+    void StartFadeIn();
+
+    /// Accumulates a frame of source output into the intermediate mixers.
+    void Mix(const StereoFrame16& frame, std::array<QuadFrame32, 3>& mixes);
+
+    /// Whether the next Mix would add nothing: every gain is zero and stays zero, and no fade-in
+    /// is waiting to start.
+    bool IsSilent() const;
+
+private:
+    using GainMatrix = std::array<std::array<float, 4>, 3>;
+
+    /// Gains at the end of the previous frame.
+    GainMatrix gain{};
+    /// Gains to reach by the end of the next frame.
+    GainMatrix target{};
+    /// Which mixers have a ramp pending.
+    std::array<bool, 3> ramping{};
+    bool fade_in = false;
+};
+
+} // namespace HLE
+} // namespace DSP
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common_types.h"
+#include "dsp.h"
+#include "engine.h"
+#include "hle_common.h"
+
+/**
+ * Full-polyphony stress scene: all of the DSP's sources playing at once with the costliest features
+ * turned on, for measuring the worst-case time of a frame. That worst case sets the frame budget.
+ *
+ * Sources cycle through PCM8, PCM16 and ADPCM, mono and stereo (ADPCM is always mono) and the three
+ * interpolation modes, so every combination appears. Every source runs both filters and feeds all
+ * three mixers, and both auxiliary mixes run a delay effect. Rates run from 0.5 to about 2.7, so
+ * the interpolators both upsample and downsample. Each source loops over a buffer of its own, so
+ * none ever stops and no two share data in the cache.
+ *
+ * The configuration functions write the shared structures directly, so they also work on the
+ * copies ConfigWriter stages. Measure runs the scene on an Engine and times each frame with
+ * svcGetSystemTick on the 3DS and steady_clock elsewhere.
+ */
+namespace DSP {
+namespace HLE {
+namespace StressScene {
+
+/// Samples in each source's buffer, about a second at the native rate.
+constexpr u32 buffer_samples = 32768;
+/// Bytes between the starts of two sources' buffers: enough for stereo PCM16.
+constexpr u32 buffer_stride = buffer_samples * 4;
+/// Bytes of sample data for the whole scene.
+constexpr u32 data_size = buffer_stride * AudioCore::num_sources;
+
+/// Fills `data`, data_size bytes, with each source's samples in its format.
+void FillSampleData(u8* data);
+
+/// Sets source `index` playing its buffer. `data_address` is the physical address of the data.
+void ConfigureSource(size_t index, SourceConfiguration::Configuration& config, PAddr data_address);
+
+/// Sets the ADPCM predictor coefficients of every source.
+void ConfigureAdpcm(AdpcmCoefficients& coefficients);
+
+/// Sets the mixer volumes and both delay effects.
+void ConfigureMixers(DspConfiguration& config);
+
+/// All of the above, into one region.
+void Configure(SharedMemory& region, PAddr data_address);
+
+/// Engine time of each frame of a run, in microseconds.
+struct Measurement {
+    std::vector<double> frame_us;
+    /// Fewest sources playing after any frame; num_sources unless the scene is broken.
+    size_t min_active_sources;
+};
+
+/// Renders `frames` frames of the scene with Engine::Tick, timing each one.
+Measurement Measure(size_t frames, Precision precision = Precision::BitExact);
+
+/**
+ * Deviation of the preview pipelines from the bit-exact ones over `frames` frames of the scene, as
+ * measured by the engine's error meter. The meter runs a bit-exact engine alongside, so this is
+ * not timed.
+ */
+ErrorStats MeasurePreviewError(size_t frames);
+
+struct Summary {
+    double mean;
+    double median;
+    double p99;
+    double max;
+    size_t worst_frame;
+};
+
+Summary Summarize(const Measurement& measurement);
+
+/// Length of a frame in microseconds, the time the DSP has for it: 160 samples at 32728 Hz.
+constexpr double frame_budget_us = AudioCore::samples_per_frame * 1e6 / native_sample_rate;
+
+} // namespace StressScene
+} // namespace HLE
+} // namespace DSP
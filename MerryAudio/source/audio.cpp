@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <array>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <experimental/optional>
 #include <vector>
 
@@ -12,6 +14,10 @@
 using namespace std;
 using namespace std::experimental;
 
+// The dirty flags of both configuration blocks are the first word of the block.
+static_assert(sizeof(DSP::HLE::SourceConfiguration::Configuration::dirty_raw) == 4, "");
+static_assert(sizeof(DSP::HLE::DspConfiguration::dirty_raw) == 4, "");
+
 #define VERIFY(call)                       \
     if (R_FAILED(call)) {                  \
         printf("failed at %s\n", #call);   \
@@ -242,8 +248,195 @@ void AudioState::waitForSync() {
     svcClearEvent(pipe2_irq);
 }
 
+void AudioState::waitForSync(FrameSnapshot& snapshot) {
+    waitForSync();
+    snapshot.capture(*this);
+}
+
 void AudioState::notifyDsp() {
     write().frame_counter[0] = frame_id;
     frame_id++;
     svcSignalEvent(dsp_semaphore);
 }
+
+FrameScheduler::FrameScheduler(AudioState& state)
+    : state(state),
+      deadline_ticks(static_cast<u64>(SYSCLOCK_ARM11 * AudioCore::samples_per_frame / 32728.0)),
+      dsp_dropped_frames(state.read().dsp_status->dropped_frames) {}
+
+FrameScheduler::Handle FrameScheduler::add(Condition condition, Action action, bool repeat) {
+    const Handle handle = next_handle++;
+    (running ? added : tasks).push_back(Task{handle, move(condition), move(action), repeat, false});
+    return handle;
+}
+
+FrameScheduler::Handle FrameScheduler::everyFrame(Action action) {
+    return add(nullptr, move(action), true);
+}
+
+FrameScheduler::Handle FrameScheduler::when(Condition condition, Action action) {
+    return add(move(condition), move(action), false);
+}
+
+FrameScheduler::Handle FrameScheduler::whenSync(size_t source, u16 sync, Action action) {
+    return when([source, sync](const AudioState& s) { return s.read().source_statuses->status[source].sync == sync; },
+                move(action));
+}
+
+FrameScheduler::Handle FrameScheduler::onBufferChange(size_t source, function<void(AudioState&, u16)> action) {
+    return add([source](const AudioState& s) { return s.read().source_statuses->status[source].current_buffer_id_dirty != 0; },
+               [source, action = move(action)](AudioState& s) { action(s, s.read().source_statuses->status[source].current_buffer_id); },
+               true);
+}
+
+void FrameScheduler::cancel(Handle handle) {
+    for (auto* list : {&tasks, &added}) {
+        for (Task& task : *list) {
+            if (task.handle == handle)
+                task.done = true;
+        }
+    }
+}
+
+void FrameScheduler::beginFrame() {
+    endFrame();
+
+    if (frame_snapshot)
+        state.waitForSync(*frame_snapshot);
+    else
+        state.waitForSync();
+    frame_start = svcGetSystemTick();
+    frame_open = true;
+    frames_begun++;
+
+    const u16 dropped = state.read().dsp_status->dropped_frames;
+    frame_stats.dropped_frames += static_cast<u16>(dropped - dsp_dropped_frames);
+    dsp_dropped_frames = dropped;
+
+    running = true;
+    for (Task& task : tasks) {
+        if (task.done || (task.condition && !task.condition(state)))
+            continue;
+        task.action(state);
+        if (!task.repeat)
+            task.done = true;
+    }
+    running = false;
+
+    tasks.erase(remove_if(tasks.begin(), tasks.end(), [](const Task& task) { return task.done; }), tasks.end());
+    for (Task& task : added) {
+        if (!task.done)
+            tasks.push_back(move(task));
+    }
+    added.clear();
+}
+
+void FrameScheduler::endFrame() {
+    if (!frame_open)
+        return;
+
+    const u64 ticks = svcGetSystemTick() - frame_start;
+    frame_stats.frames++;
+    frame_stats.total_ticks += ticks;
+    frame_stats.max_ticks = max(frame_stats.max_ticks, ticks);
+    if (ticks > deadline_ticks)
+        frame_stats.late_frames++;
+
+    state.notifyDsp();
+    frame_open = false;
+}
+
+void FrameScheduler::enableSnapshots() {
+    if (!frame_snapshot)
+        frame_snapshot = make_unique<FrameSnapshot>();
+}
+
+void FrameScheduler::runFrame() {
+    beginFrame();
+    endFrame();
+}
+
+void FrameScheduler::runFrames(size_t count) {
+    for (size_t i = 0; i < count; i++)
+        runFrame();
+}
+
+bool FrameScheduler::runUntil(const Condition& condition, size_t max_frames) {
+    for (size_t i = 0; i < max_frames; i++) {
+        beginFrame();
+        if (condition(state))
+            return true;
+    }
+    return false;
+}
+
+namespace {
+
+/// Copies a block out of shared memory in one go.
+template <typename Block>
+void copyOut(Block& out, const volatile Block* shared) {
+    memcpy(static_cast<void*>(&out), const_cast<const Block*>(shared), sizeof(Block));
+}
+
+/// Copies a configuration block out of shared memory, with its dirty flags cleared.
+template <typename Block>
+void stage(Block& staged, volatile Block* shared) {
+    copyOut(staged, shared);
+    staged.dirty_raw = 0;
+}
+
+/// Copies everything but the dirty word back, then sets the staged dirty flags. The DSP only reads
+/// the region after notifyDsp, so the order of the two stores does not matter to it.
+template <typename Block>
+void store(volatile Block* shared, const Block& staged) {
+    constexpr size_t dirty_size = sizeof(staged.dirty_raw);
+    memcpy(reinterpret_cast<u8*>(const_cast<Block*>(shared)) + dirty_size,
+           reinterpret_cast<const u8*>(&staged) + dirty_size, sizeof(Block) - dirty_size);
+    const u32 dirty = staged.dirty_raw;
+    if (dirty)
+        shared->dirty_raw = shared->dirty_raw | dirty;
+}
+
+} // anonymous namespace
+
+void FrameSnapshot::capture(const AudioState& state) {
+    const SharedMem& region = state.read();
+    frame_counter = *region.frame_counter;
+    copyOut(source_statuses, region.source_statuses);
+    copyOut(dsp_status, region.dsp_status);
+    copyOut(intermediate_mix_samples, region.intermediate_mix_samples);
+    copyOut(final_samples, region.final_samples);
+}
+
+ConfigWriter::ConfigWriter(const AudioState& state) : region(state.write()) {}
+
+ConfigWriter::~ConfigWriter() {
+    commit();
+}
+
+ConfigWriter::Configuration& ConfigWriter::source(size_t index) {
+    if (!(touched_sources & (1u << index))) {
+        stage(sources[index], &region.source_configurations->config[index]);
+        touched_sources |= 1u << index;
+    }
+    return sources[index];
+}
+
+DSP::HLE::DspConfiguration& ConfigWriter::dsp() {
+    if (!touched_dsp) {
+        stage(dsp_configuration, region.dsp_configuration);
+        touched_dsp = true;
+    }
+    return dsp_configuration;
+}
+
+void ConfigWriter::commit() {
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (touched_sources & (1u << i))
+            store(&region.source_configurations->config[i], sources[i]);
+    }
+    if (touched_dsp)
+        store(region.dsp_configuration, dsp_configuration);
+    touched_sources = 0;
+    touched_dsp = false;
+}
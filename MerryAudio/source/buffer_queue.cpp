@@ -0,0 +1,91 @@
+#include "buffer_queue.h"
+
+namespace DSP {
+namespace HLE {
+
+void BufferQueue::Reset() {
+    pending_count = 0;
+    current = {};
+    position = 0;
+    status_position = 0;
+    playing = false;
+    fresh = false;
+    buffer_update = false;
+}
+
+void BufferQueue::ClearPending() {
+    pending_count = 0;
+    current.is_looping = false;
+}
+
+void BufferQueue::Push(const Buffer& buffer) {
+    if (pending_count == capacity)
+        return;
+
+    // Stable insertion: a buffer goes after any waiting buffer with the same id.
+    size_t i = pending_count;
+    while (i > 0 && pending[i - 1].buffer_id > buffer.buffer_id) {
+        pending[i] = pending[i - 1];
+        i--;
+    }
+    pending[i] = buffer;
+    pending_count++;
+}
+
+bool BufferQueue::Prime() {
+    if (playing && position < current.length)
+        return true;
+    if (Advance())
+        return true;
+
+    // Nothing left to play: the source reports buffer id 0 and stops.
+    buffer_update = true;
+    playing = false;
+    status_position = 0;
+    return false;
+}
+
+bool BufferQueue::Advance() {
+    // A looping buffer goes back into the queue when it finishes, so it plays again unless a lower
+    // buffer_id was queued meanwhile or the queue was reset.
+    if (playing && current.is_looping && current.length != 0) {
+        Buffer again = current;
+        again.has_played = true;
+        Push(again);
+    }
+
+    while (pending_count != 0) {
+        Buffer next = pending[0];
+        std::copy(pending.begin() + 1, pending.begin() + pending_count, pending.begin());
+        pending_count--;
+
+        // The first playthrough starts at play_position, loops start at the beginning. A buffer
+        // with nothing left to play never becomes current, so its id is never reported in the
+        // status, but it is consumed all the same and raises buffer_update like one that played.
+        // A looping one still comes back for its next playthrough.
+        const u32 start = next.has_played ? 0 : std::min(next.play_position, next.length);
+        if (start >= next.length) {
+            if (next.from_queue && !next.has_played)
+                buffer_update = true;
+            if (next.is_looping && next.length != 0) {
+                next.has_played = true;
+                Push(next);
+            }
+            continue;
+        }
+
+        current = next;
+        position = start;
+        status_position = position;
+        playing = true;
+        fresh = true;
+        if (current.from_queue && !current.has_played)
+            buffer_update = true;
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace HLE
+} // namespace DSP
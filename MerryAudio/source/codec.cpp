@@ -0,0 +1,108 @@
+#include <cstring>
+
+#include "codec.h"
+#include "fixed_point.h"
+#include "simd.h"
+
+namespace DSP {
+namespace HLE {
+namespace Codec {
+
+u32 BytesForSamples(Format format, unsigned channels, u32 samples) {
+    switch (format) {
+    case Format::PCM8:
+        return samples * channels;
+    case Format::PCM16:
+        return samples * channels * 2;
+    case Format::ADPCM:
+        return (samples + adpcm_frame_samples - 1) / adpcm_frame_samples * adpcm_frame_bytes;
+    }
+    return 0;
+}
+
+void DecodePCM8(const u8* data, unsigned channels, u32 offset, u32 count, s16* left, s16* right) {
+    const s8* input = reinterpret_cast<const s8*>(data) + offset * channels;
+    u32 i = 0;
+
+    if (channels == 1) {
+        for (; i + 16 <= count; i += 16) {
+            const SIMD::S8x16 x = SIMD::Load(input + i);
+            SIMD::Store(left + i, SIMD::ExpandLow(x));
+            SIMD::Store(left + i + 8, SIMD::ExpandHigh(x));
+        }
+        for (; i < count; i++)
+            left[i] = static_cast<s16>(input[i] * 256);
+    } else {
+        for (; i + 8 <= count; i += 8) {
+            const SIMD::S8x16 x = SIMD::Load(input + 2 * i);
+            SIMD::S16x8 l, r;
+            SIMD::Deinterleave(SIMD::ExpandLow(x), SIMD::ExpandHigh(x), l, r);
+            SIMD::Store(left + i, l);
+            SIMD::Store(right + i, r);
+        }
+        for (; i < count; i++) {
+            left[i] = static_cast<s16>(input[2 * i + 0] * 256);
+            right[i] = static_cast<s16>(input[2 * i + 1] * 256);
+        }
+    }
+}
+
+void DecodePCM16(const u8* data, unsigned channels, u32 offset, u32 count, s16* left, s16* right) {
+    const u8* input = data + offset * channels * 2;
+
+    if (channels == 1) {
+        std::memcpy(left, input, count * 2);
+        return;
+    }
+
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        SIMD::S16x8 l, r;
+        SIMD::Deinterleave(SIMD::Load(reinterpret_cast<const s16*>(input + 4 * i)),
+                           SIMD::Load(reinterpret_cast<const s16*>(input + 4 * i + 16)), l, r);
+        SIMD::Store(left + i, l);
+        SIMD::Store(right + i, r);
+    }
+    for (; i < count; i++) {
+        s16 pair[2];
+        std::memcpy(pair, input + 4 * i, sizeof(pair));
+        left[i] = pair[0];
+        right[i] = pair[1];
+    }
+}
+
+void DecodeADPCM(const u8* data, u32 offset, u32 count, const std::array<s16, 16>& coeffs, AdpcmState& state, s16* out) {
+    s32 yn1 = state.yn1;
+    s32 yn2 = state.yn2;
+
+    u32 n = offset;
+    for (u32 i = 0; i < count; ) {
+        const u8* frame = data + (n / adpcm_frame_samples) * adpcm_frame_bytes;
+        const s32 scale = 1 << (frame[0] & 0xF);
+        const size_t index = (frame[0] >> 4) & 0x7;
+        const Q11 coef1 = Q11::FromRaw(coeffs[index * 2 + 0]);
+        const Q11 coef2 = Q11::FromRaw(coeffs[index * 2 + 1]);
+
+        // Decode up to the end of this ADPCM frame.
+        for (u32 nibble = n % adpcm_frame_samples; nibble < adpcm_frame_samples && i < count; nibble++, n++, i++) {
+            const u8 byte = frame[1 + nibble / 2];
+            const s32 xn = static_cast<s8>((nibble % 2 == 0 ? byte : byte << 4) & 0xF0) >> 4;
+
+            // y[n] = x[n] * scale + c1 * y[n-1] + c2 * y[n-2], rounded to nearest, summed in 32 bits.
+            Accumulator<11, s32> acc = Accumulator<11, s32>::FromInteger(xn * scale);
+            acc.MulAdd(coef1, yn1);
+            acc.MulAdd(coef2, yn2);
+            acc.AddHalf();
+            yn2 = yn1;
+            yn1 = acc.Saturate();
+            out[i] = static_cast<s16>(yn1);
+        }
+    }
+
+    state.yn1 = static_cast<s16>(yn1);
+    state.yn2 = static_cast<s16>(yn2);
+}
+
+} // namespace Codec
+} // namespace HLE
+} // namespace DSP
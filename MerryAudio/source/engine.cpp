@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "engine.h"
+#include "profiler.h"
+#include "simd.h"
+
+namespace DSP {
+namespace HLE {
+
+Engine::Engine(MemoryTranslator memory_) : memory(std::move(memory_)) {
+    Reset();
+}
+
+void Engine::Reset() {
+    for (auto& source : state.sources)
+        source.Reset();
+    state.mixers.Reset();
+    state.frame_id = 0;
+    if (reference)
+        reference->Reset();
+}
+
+void Engine::SetPrecision(Precision precision_) {
+    precision = precision_;
+    for (auto& source : state.sources)
+        source.SetPrecision(precision);
+}
+
+void Engine::SaveState(EngineState& out) const {
+    std::memcpy(static_cast<void*>(&out), &state, sizeof(EngineState));
+}
+
+void Engine::LoadState(const EngineState& in) {
+    std::memcpy(static_cast<void*>(&state), &in, sizeof(EngineState));
+    // Each source carries the precision of the engine that saved it.
+    for (auto& source : state.sources)
+        source.SetPrecision(precision);
+}
+
+void Engine::EnableErrorMeter(bool enable) {
+    if (!enable) {
+        reference.reset();
+        reference_region.reset();
+        return;
+    }
+
+    reference = std::make_unique<Engine>(memory);
+    reference->LoadState(state);
+    reference->SetPrecision(Precision::BitExact);
+    reference_region = std::make_unique<SharedMemory>();
+}
+
+void Engine::Tick(SharedMemory& region) {
+    if (!reference) {
+        Process(region);
+        return;
+    }
+
+    // The reference has to see the configuration before this engine clears its dirty flags.
+    std::memcpy(static_cast<void*>(reference_region.get()), &region, sizeof(SharedMemory));
+    Process(region);
+    reference->Process(*reference_region);
+    MeasureError(reference_region->final_samples, region.final_samples);
+}
+
+void Engine::Render(SharedMemory* const* regions, size_t count) {
+    // The error meter and probes compare and report frame by frame.
+    if (tuner.chosen == 1 || reference || probe) {
+        for (size_t i = 0; i < count; i++)
+            Tick(*regions[i]);
+        return;
+    }
+
+    if (!batch_mixes)
+        batch_mixes = std::make_unique<std::array<Mixes, max_batch_frames>>();
+
+    while (count > 0) {
+        if (tuner.chosen != 0) {
+            const size_t frames = std::min(count, tuner.chosen);
+            ProcessBatch(regions, frames, batch_mixes->data());
+            regions += frames;
+            count -= frames;
+            continue;
+        }
+
+        const size_t frames = std::min(count, BatchTuner::candidates[tuner.candidate]);
+        const u64 start = Profiler::Now();
+        ProcessBatch(regions, frames, batch_mixes->data());
+        tuner.ticks[tuner.candidate] += Profiler::Now() - start;
+        regions += frames;
+        count -= frames;
+
+        tuner.frames_timed += frames;
+        if (tuner.frames_timed >= BatchTuner::frames_per_candidate) {
+            tuner.frames_timed = 0;
+            if (++tuner.candidate == BatchTuner::candidates.size()) {
+                const auto fastest = std::min_element(tuner.ticks.begin(), tuner.ticks.end());
+                tuner.chosen = BatchTuner::candidates[fastest - tuner.ticks.begin()];
+            }
+        }
+    }
+}
+
+void Engine::SetBatchFrames(size_t frames) {
+    tuner = {};
+    tuner.chosen = std::min(frames, max_batch_frames);
+}
+
+void Engine::MeasureError(const FinalMixSamples& expected, const FinalMixSamples& actual) {
+    // Samples are below 2^16 apart, so their difference is exact in float. It and its square are
+    // summed in float over the frame, then added to the double totals.
+    const SIMD::F32x4 zero = SIMD::Splat(0.0f);
+    SIMD::F32x4 max = zero;
+    SIMD::F32x4 sum = zero;
+    SIMD::F32x4 sum_of_squares = zero;
+    for (size_t i = 0; i < 2 * AudioCore::samples_per_frame; i += SIMD::lanes) {
+        const SIMD::F32x4 difference = SIMD::ToFloat(SIMD::LoadWiden(&actual.pcm16[i])) -
+                                       SIMD::ToFloat(SIMD::LoadWiden(&expected.pcm16[i]));
+        max = SIMD::Max(max, SIMD::Max(difference, zero - difference));
+        sum = sum + difference;
+        sum_of_squares = sum_of_squares + difference * difference;
+    }
+
+    alignas(16) std::array<float, SIMD::lanes> lane_max, lane_sum, lane_sum_of_squares;
+    SIMD::Store(lane_max.data(), max);
+    SIMD::Store(lane_sum.data(), sum);
+    SIMD::Store(lane_sum_of_squares.data(), sum_of_squares);
+    for (size_t lane = 0; lane < SIMD::lanes; lane++) {
+        error_stats.max_deviation = std::max(error_stats.max_deviation, static_cast<s32>(lane_max[lane]));
+        error_stats.sum += lane_sum[lane];
+        error_stats.sum_of_squares += lane_sum_of_squares[lane];
+    }
+    error_stats.samples += 2 * AudioCore::samples_per_frame;
+}
+
+void Engine::Process(SharedMemory& region) {
+    SharedMemory* const regions[] = {&region};
+    ProcessBatch(regions, 1, &intermediate_mixes);
+}
+
+void Engine::ProcessBatch(SharedMemory* const* regions, size_t count, Mixes* mixes) {
+    PROFILE_FRAME(regions[0]->frame_counter);
+    PROFILE_SCOPE(Frame);
+
+    for (size_t frame = 0; frame < count; frame++) {
+        for (auto& mix : mixes[frame]) {
+            for (auto& channel : mix)
+                channel.fill(0);
+        }
+    }
+
+    // Sources depend only on their own configuration, so each can run through the whole batch.
+    skipped_sources = 0;
+    for (size_t i = 0; i < state.sources.size(); i++) {
+        Source& source = state.sources[i];
+        PROFILE_SOURCE_SCOPE(i);
+        for (size_t frame = 0; frame < count; frame++) {
+            SharedMemory& region = *regions[frame];
+            {
+                PROFILE_SCOPE(Queue);
+                source.ParseConfig(region.source_configurations.config[i], region.adpcm_coefficients.coeff[i]);
+            }
+            const bool skipped = source.GenerateFrame(memory, staging, source_output, silence_threshold, skip_muted);
+            if (skipped && frame == count - 1)
+                skipped_sources++;
+            if (probe && !skipped && source.IsPlaying())
+                probe->SourceOutput(region, i, source_output);
+            {
+                PROFILE_SCOPE(Mix);
+                source.MixInto(source_output, mixes[frame]);
+            }
+            {
+                PROFILE_SCOPE(Queue);
+                source.WriteStatus(region.source_statuses.status[i]);
+            }
+        }
+    }
+
+    for (size_t frame = 0; frame < count; frame++) {
+        SharedMemory& region = *regions[frame];
+        Mixes& frame_mixes = mixes[frame];
+        if (probe)
+            probe->IntermediateMixes(region, frame_mixes);
+        state.mixers.ParseConfig(region.dsp_configuration, region.compressor);
+        state.mixers.Tick(frame_mixes, region.final_samples);
+        state.frame_id = region.frame_counter;
+
+        // The auxiliary mixers are published after their effects have run.
+        for (size_t ch = 0; ch < 4; ch++) {
+            for (size_t i = 0; i < AudioCore::samples_per_frame; i++) {
+                region.intermediate_mix_samples.mix1.pcm32[ch][i] = frame_mixes[1][ch][i];
+                region.intermediate_mix_samples.mix2.pcm32[ch][i] = frame_mixes[2][ch][i];
+            }
+        }
+    }
+}
+
+} // namespace HLE
+} // namespace DSP
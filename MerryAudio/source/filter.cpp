@@ -0,0 +1,135 @@
+#include "filter.h"
+
+namespace DSP {
+namespace HLE {
+
+namespace {
+
+/**
+ * What the fixed-point filters' rounding down takes off each output on average, in LSBs. Their
+ * feedback recirculates it, so near DC it is amplified by 1 / (1 - a1 - a2): tens of LSBs for a
+ * high-pass biquad with a low corner. The preview filters subtract it in their feedback too, so
+ * they track that offset instead of deviating by it.
+ */
+constexpr float floor_bias = 0.5f;
+
+} // anonymous namespace
+
+void SourceFilters::Enable(bool enable_simple, bool enable_biquad) {
+    simple_enabled = enable_simple;
+    biquad_enabled = enable_biquad;
+    if (!simple_enabled) {
+        simple.y1.fill(0);
+        preview.simple_y1.fill(0.0f);
+    }
+    if (!biquad_enabled) {
+        biquad.x1.fill(0);
+        biquad.x2.fill(0);
+        biquad.y1.fill(0);
+        biquad.y2.fill(0);
+        preview.x1.fill(0.0f);
+        preview.x2.fill(0.0f);
+        preview.y1.fill(0.0f);
+        preview.y2.fill(0.0f);
+    }
+}
+
+void SourceFilters::Configure(const SourceConfiguration::Configuration::SimpleFilter& config) {
+    simple.b0 = Q15::FromRaw(config.b0);
+    simple.a1 = Q15::FromRaw(config.a1);
+}
+
+void SourceFilters::Configure(const SourceConfiguration::Configuration::BiquadFilter& config) {
+    biquad.a1 = Q14::FromRaw(config.a1);
+    biquad.a2 = Q14::FromRaw(config.a2);
+    biquad.b0 = Q14::FromRaw(config.b0);
+    biquad.b1 = Q14::FromRaw(config.b1);
+    biquad.b2 = Q14::FromRaw(config.b2);
+}
+
+void SourceFilters::ProcessSimple(StereoFrame16& frame, size_t channels) {
+    const Q15 b0 = simple.b0;
+    const Q15 a1 = simple.a1;
+
+    for (size_t ch = 0; ch < channels; ch++) {
+        s16 y1 = simple.y1[ch];
+        for (s16& sample : frame[ch]) {
+            // y[n] = b0 x[n] + a1 y[n-1], summed in 32 bits as AudioTest-SimpleFilter models it.
+            Accumulator<15, s32> acc;
+            acc.MulAdd(b0, sample);
+            acc.MulAdd(a1, y1);
+            y1 = acc.Saturate();
+            sample = y1;
+        }
+        simple.y1[ch] = y1;
+    }
+}
+
+void SourceFilters::ProcessBiquad(StereoFrame16& frame, size_t channels) {
+    const BiquadState& c = biquad;
+
+    for (size_t ch = 0; ch < channels; ch++) {
+        s16 x1 = biquad.x1[ch], x2 = biquad.x2[ch];
+        s16 y1 = biquad.y1[ch], y2 = biquad.y2[ch];
+        for (s16& sample : frame[ch]) {
+            // y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+            Accumulator<14> acc;
+            acc.MulAdd(c.b0, sample);
+            acc.MulAdd(c.b1, x1);
+            acc.MulAdd(c.b2, x2);
+            acc.MulAdd(c.a1, y1);
+            acc.MulAdd(c.a2, y2);
+            x2 = x1;
+            x1 = sample;
+            y2 = y1;
+            y1 = acc.Saturate();
+            sample = y1;
+        }
+        biquad.x1[ch] = x1;
+        biquad.x2[ch] = x2;
+        biquad.y1[ch] = y1;
+        biquad.y2[ch] = y2;
+    }
+}
+
+void SourceFilters::ProcessSimplePreview(StereoFrameFloat& frame, size_t channels) {
+    const float b0 = static_cast<float>(simple.b0.ToDouble());
+    const float a1 = static_cast<float>(simple.a1.ToDouble());
+
+    for (size_t ch = 0; ch < channels; ch++) {
+        float y1 = preview.simple_y1[ch];
+        for (float& sample : frame[ch]) {
+            y1 = b0 * sample + a1 * y1 - floor_bias;
+            sample = y1;
+        }
+        preview.simple_y1[ch] = y1;
+    }
+}
+
+void SourceFilters::ProcessBiquadPreview(StereoFrameFloat& frame, size_t channels) {
+    const float b0 = static_cast<float>(biquad.b0.ToDouble());
+    const float b1 = static_cast<float>(biquad.b1.ToDouble());
+    const float b2 = static_cast<float>(biquad.b2.ToDouble());
+    const float a1 = static_cast<float>(biquad.a1.ToDouble());
+    const float a2 = static_cast<float>(biquad.a2.ToDouble());
+
+    for (size_t ch = 0; ch < channels; ch++) {
+        float x1 = preview.x1[ch], x2 = preview.x2[ch];
+        float y1 = preview.y1[ch], y2 = preview.y2[ch];
+        for (float& sample : frame[ch]) {
+            const float y0 = b0 * sample + b1 * x1 + b2 * x2 + a1 * y1 + a2 * y2 - floor_bias;
+            x2 = x1;
+            x1 = sample;
+            y2 = y1;
+            y1 = y0;
+            sample = y0;
+        }
+        preview.x1[ch] = x1;
+        preview.x2[ch] = x2;
+        preview.y1[ch] = y1;
+        preview.y2[ch] = y2;
+    }
+}
+
+} // namespace HLE
+} // namespace DSP
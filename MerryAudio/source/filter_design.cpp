@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "filter_design.h"
+#include "simd.h"
+
+namespace DSP {
+namespace HLE {
+namespace FilterDesign {
+
+namespace {
+
+// The test filters keep working through the quantizer.
+static_assert(IsStable(Quantize(LowPass(2000.0, 0.7071))), "Quantized lowpass must be stable");
+static_assert(IsStable(Quantize(OnePoleLowPass(1000.0))), "Quantized one-pole lowpass must be stable");
+static_assert(IsRepresentable(Peaking(1000.0, 1.0, 6.0)), "A 6 dB peak must fit in Q14");
+
+/**
+ * Runs `evaluate` over the sweep four frequencies at a time. It receives cos(w) for each lane and
+ * returns the magnitude.
+ */
+template <typename Evaluate>
+void Sweep(const float* frequencies, float* magnitudes, size_t count, double sample_rate, Evaluate&& evaluate) {
+    const double to_radians = 2.0 * detail::pi / sample_rate;
+
+    for (size_t i = 0; i < count; i += SIMD::lanes) {
+        const size_t n = std::min(SIMD::lanes, count - i);
+
+        alignas(16) std::array<float, SIMD::lanes> cos_w{};
+        for (size_t j = 0; j < n; j++)
+            cos_w[j] = static_cast<float>(std::cos(frequencies[i + j] * to_radians));
+
+        alignas(16) std::array<float, SIMD::lanes> result;
+        SIMD::Store(result.data(), evaluate(SIMD::Load(cos_w.data())));
+        std::copy_n(result.begin(), n, magnitudes + i);
+    }
+}
+
+} // anonymous namespace
+
+void MagnitudeResponse(const SimpleFilter& filter, const float* frequencies, float* magnitudes, size_t count, double sample_rate) {
+    const OnePole design = Dequantize(filter);
+
+    // |H|^2 = b0^2 / (1 - 2 a1 cos w + a1^2)
+    const SIMD::F32x4 numerator = SIMD::Splat(static_cast<float>(design.b0 * design.b0));
+    const SIMD::F32x4 d0 = SIMD::Splat(static_cast<float>(1.0 + design.a1 * design.a1));
+    const SIMD::F32x4 d1 = SIMD::Splat(static_cast<float>(-2.0 * design.a1));
+
+    Sweep(frequencies, magnitudes, count, sample_rate, [&](SIMD::F32x4 c) {
+        return SIMD::Sqrt(numerator / (d0 + d1 * c));
+    });
+}
+
+void MagnitudeResponse(const BiquadFilter& filter, const float* frequencies, float* magnitudes, size_t count, double sample_rate) {
+    const Biquad d = Dequantize(filter);
+
+    // With c = cos w, |b0 + b1 e^-jw + b2 e^-2jw|^2 = n0 + n1 c + n2 (2c^2 - 1), likewise for the
+    // denominator with a0 = 1.
+    const SIMD::F32x4 n0 = SIMD::Splat(static_cast<float>(d.b0 * d.b0 + d.b1 * d.b1 + d.b2 * d.b2));
+    const SIMD::F32x4 n1 = SIMD::Splat(static_cast<float>(2.0 * (d.b0 * d.b1 + d.b1 * d.b2)));
+    const SIMD::F32x4 n2 = SIMD::Splat(static_cast<float>(2.0 * d.b0 * d.b2));
+    const SIMD::F32x4 m0 = SIMD::Splat(static_cast<float>(1.0 + d.a1 * d.a1 + d.a2 * d.a2));
+    const SIMD::F32x4 m1 = SIMD::Splat(static_cast<float>(2.0 * (d.a1 + d.a1 * d.a2)));
+    const SIMD::F32x4 m2 = SIMD::Splat(static_cast<float>(2.0 * d.a2));
+    const SIMD::F32x4 one = SIMD::Splat(1.0f);
+    const SIMD::F32x4 two = SIMD::Splat(2.0f);
+
+    Sweep(frequencies, magnitudes, count, sample_rate, [&](SIMD::F32x4 c) {
+        const SIMD::F32x4 cos_2w = two * c * c - one;
+        return SIMD::Sqrt((n0 + n1 * c + n2 * cos_2w) / (m0 + m1 * c + m2 * cos_2w));
+    });
+}
+
+} // namespace FilterDesign
+} // namespace HLE
+} // namespace DSP
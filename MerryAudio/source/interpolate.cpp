@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cmath>
+
+#include "fixed_point.h"
+#include "interpolate.h"
+#include "simd.h"
+
+namespace DSP {
+namespace HLE {
+namespace AudioInterp {
+
+namespace {
+
+constexpr u32 fraction_mask = (1 << position_bits) - 1;
+
+/// Polyphase kernels are tabulated for this many fractional positions.
+constexpr unsigned phase_bits = 7;
+constexpr size_t num_phases = 1 << phase_bits;
+constexpr size_t num_taps = 4;
+
+using Kernel = std::array<std::array<Q15, num_taps>, num_phases>;
+
+/// Designs a Hann-windowed sinc kernel for each phase, normalised to unity gain in Q15.
+Kernel DesignKernel(double cutoff) {
+    constexpr double pi = 3.14159265358979323846;
+    Kernel ret{};
+
+    for (size_t phase = 0; phase < num_phases; phase++) {
+        const double p = static_cast<double>(phase) / num_phases;
+
+        std::array<double, num_taps> taps;
+        double sum = 0.0;
+        for (size_t t = 0; t < num_taps; t++) {
+            // Taps sit at -1, 0, 1, 2 relative to the sample before the interpolation point.
+            const double x = static_cast<double>(t) - 1.0 - p;
+            const double sinc = x == 0.0 ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+            const double window = 0.5 * (1.0 + std::cos(pi * x / 2.0));
+            taps[t] = sinc * window;
+            sum += taps[t];
+        }
+
+        s32 total = 0;
+        for (size_t t = 0; t < num_taps; t++) {
+            ret[phase][t] = Q15::FromRaw(static_cast<s16>(std::lround(taps[t] / sum * 32767.0)));
+            total += ret[phase][t].raw;
+        }
+        // Put the rounding error on the largest tap so a DC input passes through unchanged.
+        const size_t largest = p < 0.5 ? 1 : 2;
+        ret[phase][largest].raw = static_cast<s16>(ret[phase][largest].raw + (32767 - total));
+    }
+
+    return ret;
+}
+
+const std::array<Kernel, 4> polyphase_kernels{{
+    DesignKernel(1.0),
+    DesignKernel(0.9),
+    DesignKernel(0.75),
+    DesignKernel(0.6),
+}};
+
+using FloatKernel = std::array<std::array<float, num_taps>, num_phases>;
+
+std::array<FloatKernel, 4> ToFloat(const std::array<Kernel, 4>& kernels) {
+    std::array<FloatKernel, 4> ret;
+    for (size_t set = 0; set < kernels.size(); set++) {
+        for (size_t phase = 0; phase < num_phases; phase++) {
+            for (size_t t = 0; t < num_taps; t++)
+                ret[set][phase][t] = static_cast<float>(kernels[set][phase][t].ToDouble());
+        }
+    }
+    return ret;
+}
+
+const std::array<FloatKernel, 4> polyphase_kernels_float = ToFloat(polyphase_kernels);
+
+/// Lanes gathered for one group of four outputs.
+struct Gathered {
+    alignas(16) std::array<std::array<float, SIMD::lanes>, num_taps> x;
+    alignas(16) std::array<float, SIMD::lanes> fraction;
+    std::array<u32, SIMD::lanes> phase;
+};
+
+/// Gathers `taps` input samples starting at staging[(position >> 16) + first] for four outputs.
+FORCE_INLINE void Gather(const s16* staging, u32& position, u32 rate, size_t first, size_t taps, Gathered& g) {
+    for (size_t lane = 0; lane < SIMD::lanes; lane++, position += rate) {
+        const s16* x = &staging[(position >> position_bits) + first];
+        for (size_t t = 0; t < taps; t++)
+            g.x[t][lane] = x[t];
+        g.fraction[lane] = static_cast<float>(position & fraction_mask) * (1.0f / (1 << position_bits));
+        g.phase[lane] = (position & fraction_mask) >> (position_bits - phase_bits);
+    }
+}
+
+} // anonymous namespace
+
+u32 RateToFixed(float rate_multiplier) {
+    if (!(rate_multiplier > 0.0f))
+        return 0;
+    return static_cast<u32>(std::min<double>(rate_multiplier * (1 << position_bits), max_rate));
+}
+
+void None(const s16* staging, u32 fraction, u32 rate, s16* out) {
+    u32 position = fraction;
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i++, position += rate)
+        out[i] = staging[(position >> position_bits) + 2];
+}
+
+void Linear(const s16* staging, u32 fraction, u32 rate, s16* out) {
+    u32 position = fraction;
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i++, position += rate) {
+        const s16* x = &staging[(position >> position_bits) + 2];
+        const s32 delta = SaturateS16(x[1] - x[0]);
+        const s32 f0 = position & fraction_mask;
+        out[i] = static_cast<s16>(x[0] + ((f0 * delta) >> position_bits));
+    }
+}
+
+void Polyphase(const s16* staging, u32 fraction, u32 rate, unsigned coefficient_set, s16* out) {
+    const Kernel& kernel = polyphase_kernels[coefficient_set % polyphase_kernels.size()];
+
+    u32 position = fraction;
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i++, position += rate) {
+        const s16* x = &staging[(position >> position_bits) + polyphase_window.first];
+        const auto& taps = kernel[(position & fraction_mask) >> (position_bits - phase_bits)];
+        Accumulator<15, s32> acc;
+        for (size_t t = 0; t < num_taps; t++)
+            acc.MulAdd(taps[t], x[t]);
+        acc.AddHalf();
+        out[i] = acc.Saturate();
+    }
+}
+
+void NonePreview(const s16* staging, u32 fraction, u32 rate, float* out) {
+    u32 position = fraction;
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i++, position += rate)
+        out[i] = staging[(position >> position_bits) + 2];
+}
+
+void LinearPreview(const s16* staging, u32 fraction, u32 rate, float* out) {
+    u32 position = fraction;
+    Gathered g;
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i += SIMD::lanes) {
+        Gather(staging, position, rate, 2, 2, g);
+        const SIMD::F32x4 x0 = SIMD::Load(g.x[0].data());
+        const SIMD::F32x4 x1 = SIMD::Load(g.x[1].data());
+        SIMD::Store(out + i, x0 + SIMD::Load(g.fraction.data()) * (x1 - x0));
+    }
+}
+
+void PolyphasePreview(const s16* staging, u32 fraction, u32 rate, unsigned coefficient_set, float* out) {
+    const FloatKernel& kernel = polyphase_kernels_float[coefficient_set % polyphase_kernels_float.size()];
+
+    u32 position = fraction;
+    Gathered g;
+    alignas(16) std::array<std::array<float, SIMD::lanes>, num_taps> taps;
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i += SIMD::lanes) {
+        Gather(staging, position, rate, polyphase_window.first, num_taps, g);
+        for (size_t lane = 0; lane < SIMD::lanes; lane++) {
+            for (size_t t = 0; t < num_taps; t++)
+                taps[t][lane] = kernel[g.phase[lane]][t];
+        }
+
+        SIMD::F32x4 acc = SIMD::Load(g.x[0].data()) * SIMD::Load(taps[0].data());
+        for (size_t t = 1; t < num_taps; t++)
+            acc = acc + SIMD::Load(g.x[t].data()) * SIMD::Load(taps[t].data());
+        SIMD::Store(out + i, acc);
+    }
+}
+
+} // namespace AudioInterp
+} // namespace HLE
+} // namespace DSP
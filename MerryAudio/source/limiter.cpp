@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "limiter.h"
+#include "simd.h"
+
+namespace DSP {
+namespace HLE {
+
+namespace {
+
+/// Peak output level the limiter holds the signal to (-0.5 dBFS).
+constexpr float ceiling_dbfs = -0.5f;
+
+/// Time for the envelope to decay by 1/e once the peak has passed.
+constexpr double release_seconds = 0.05;
+
+} // anonymous namespace
+
+void Limiter::Configure(const DspConfiguration& config, const Compressor& compressor) {
+    enabled = config.limiter_enabled != 0;
+    BuildGainCurve(compressor);
+    Reset();
+}
+
+void Limiter::Reset() {
+    envelope = 0.0f;
+}
+
+void Limiter::Disable() {
+    enabled = false;
+    Reset();
+}
+
+void Limiter::BuildGainCurve(const Compressor&) {
+    ceiling = 32767.0f * std::pow(10.0f, ceiling_dbfs / 20.0f);
+    release = static_cast<float>(std::exp(-1.0 / (release_seconds * native_sample_rate)));
+
+    // Each bin covers envelopes in [i << curve_shift, (i + 1) << curve_shift). Using the upper edge
+    // of the bin guarantees that the output never exceeds the ceiling.
+    for (size_t i = 0; i < curve_size; i++) {
+        const float upper = static_cast<float>((i + 1) << curve_shift);
+        gain_curve[i] = std::min(1.0f, ceiling / upper);
+    }
+}
+
+void Limiter::Process(StereoFrame32& frame) {
+    if (!enabled)
+        return;
+
+    // The envelope is a serial recurrence, so it is followed with scalar code. Applying the
+    // resulting gains is the expensive part and is vectorized below.
+    alignas(16) std::array<float, AudioCore::samples_per_frame> gains;
+    float env = envelope;
+    bool reducing = false;
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i++) {
+        const float peak = static_cast<float>(std::max(std::abs(frame[0][i]), std::abs(frame[1][i])));
+        env = std::max(peak, env * release);
+
+        const u32 bin = static_cast<u32>(env) >> curve_shift;
+        gains[i] = bin < curve_size ? gain_curve[bin] : ceiling / env;
+        reducing |= gains[i] < 1.0f;
+    }
+    envelope = env;
+
+    if (!reducing)
+        return;
+
+    for (auto& channel : frame) {
+        for (size_t i = 0; i < AudioCore::samples_per_frame; i += SIMD::lanes) {
+            const SIMD::F32x4 gain = SIMD::Load(&gains[i]);
+            const SIMD::F32x4 sample = SIMD::ToFloat(SIMD::Load(&channel[i]));
+            SIMD::Store(&channel[i], SIMD::Truncate(sample * gain));
+        }
+    }
+}
+
+} // namespace HLE
+} // namespace DSP
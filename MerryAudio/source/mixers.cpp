@@ -0,0 +1,232 @@
+#include <algorithm>
+
+#include "mixers.h"
+#include "profiler.h"
+#include "simd.h"
+
+namespace DSP {
+namespace HLE {
+
+namespace {
+
+/// How the four channels of an intermediate mixer are folded into the stereo output.
+enum class Fold {
+    Stereo, ///< Rear channels are added to the front channels of the same side.
+    Mono,   ///< All four channels are summed at half level into both outputs, so a signal centred
+            ///< on the front pair keeps its level.
+    Matrix, ///< Rear channels are matrix-encoded into the stereo pair (Lt/Rt).
+};
+
+/// Level of the rear sum in the matrix encode (-3 dB, split over two channels).
+constexpr float matrix_gain = 0.35355339f;
+
+/**
+ * Downmixes one intermediate mixer into the accumulator. Each fold is a separate instantiation so
+ * the inner loop contains no format checks, and every fold costs about the same: four conversions,
+ * four multiplies and a handful of adds per group of four samples.
+ */
+template <Fold fold>
+void Downmix(const QuadFrame32& mix, float volume, StereoFrame32& accumulator) {
+    const SIMD::F32x4 gain = SIMD::Splat(volume);
+
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i += SIMD::lanes) {
+        const SIMD::F32x4 front_left = gain * SIMD::ToFloat(SIMD::Load(&mix[0][i]));
+        const SIMD::F32x4 front_right = gain * SIMD::ToFloat(SIMD::Load(&mix[1][i]));
+        const SIMD::F32x4 rear_left = gain * SIMD::ToFloat(SIMD::Load(&mix[2][i]));
+        const SIMD::F32x4 rear_right = gain * SIMD::ToFloat(SIMD::Load(&mix[3][i]));
+
+        SIMD::S32x4 left, right;
+        if constexpr (fold == Fold::Stereo) {
+            left = SIMD::Truncate(front_left + rear_left);
+            right = SIMD::Truncate(front_right + rear_right);
+        } else if constexpr (fold == Fold::Mono) {
+            left = right = SIMD::Truncate((front_left + front_right + rear_left + rear_right) * SIMD::Splat(0.5f));
+        } else {
+            const SIMD::F32x4 surround = (rear_left + rear_right) * SIMD::Splat(matrix_gain);
+            left = SIMD::Truncate(front_left - surround);
+            right = SIMD::Truncate(front_right + surround);
+        }
+
+        SIMD::Store(&accumulator[0][i], SIMD::Load(&accumulator[0][i]) + left);
+        SIMD::Store(&accumulator[1][i], SIMD::Load(&accumulator[1][i]) + right);
+    }
+}
+
+} // anonymous namespace
+
+const std::array<Mixers::DownmixFn, 3> Mixers::downmix_table{{
+    Downmix<Fold::Stereo>,
+    Downmix<Fold::Mono>,
+    Downmix<Fold::Matrix>,
+}};
+
+void DelayEffect::Reset() {
+    position = 0;
+    previous.fill(0);
+    for (auto& channel : line)
+        channel.fill(0);
+}
+
+void DelayEffect::Configure(const DspConfiguration::DelayEffect& config) {
+    const bool was_enabled = enabled;
+    const u32 frames = std::clamp<u32>(config.frame_count, 1, max_frames);
+
+    enabled = config.enable != 0;
+    g = Q7::FromRaw(config.g);
+    a = Q7::FromRaw(config.a);
+    b = Q7::FromRaw(config.b);
+
+    if (frames * AudioCore::samples_per_frame != length || (enabled && !was_enabled)) {
+        length = frames * AudioCore::samples_per_frame;
+        Reset();
+    }
+}
+
+void DelayEffect::Process(QuadFrame32& mix) {
+    // The delay length is a whole number of frames, so a frame never wraps around the line.
+    const s64 ag = (static_cast<s64>(a.raw) * g.raw) >> 7;
+
+    for (size_t ch = 0; ch < mix.size(); ch++) {
+        s32* const delay = &line[ch][position];
+        s16 y1 = previous[ch];
+
+        for (size_t i = 0; i < AudioCore::samples_per_frame; i++) {
+            const s16 x = SaturateS16(mix[ch][i]);
+
+            // y[n] = w[n-N] + b y[n-1]
+            Accumulator<7> out = Accumulator<7>::FromRaw(delay[i]);
+            out.MulAdd(b, y1);
+            const s16 y = out.Saturate();
+
+            // w[n] = a x[n] - a g y[n], kept in Q7.
+            Accumulator<7> in;
+            in.MulAdd(a, x);
+            delay[i] = SaturateS32(in.Raw() - ag * y);
+
+            mix[ch][i] = y;
+            y1 = y;
+        }
+
+        previous[ch] = y1;
+    }
+
+    position = (position + AudioCore::samples_per_frame) % length;
+}
+
+Mixers::Mixers() {
+    Reset();
+}
+
+void Mixers::Reset() {
+    // Back to the configuration of a new engine, effects and limiter included, so nothing set
+    // before the reset keeps processing.
+    output_format = DspConfiguration::OutputFormat::Stereo;
+    volume.fill(0.0f);
+    mixer_enabled = {{true, false, false}};
+    partial_surround.fill(false);
+    for (auto& effect : delay_effect) {
+        effect.Configure({});
+        effect.Reset();
+    }
+    limiter.Disable();
+    SelectDownmix();
+}
+
+void Mixers::SelectDownmix() {
+    for (size_t mixer = 0; mixer < downmix.size(); mixer++) {
+        switch (output_format) {
+        case DspConfiguration::OutputFormat::Mono:
+            downmix[mixer] = static_cast<u8>(Fold::Mono);
+            break;
+        case DspConfiguration::OutputFormat::Surround:
+            // The main mixer is always surround-encoded; the auxiliary mixers only when their
+            // partial surround flag is set.
+            if (mixer == 0 || partial_surround[mixer - 1])
+                downmix[mixer] = static_cast<u8>(Fold::Matrix);
+            else
+                downmix[mixer] = static_cast<u8>(Fold::Stereo);
+            break;
+        case DspConfiguration::OutputFormat::Stereo:
+        default:
+            downmix[mixer] = static_cast<u8>(Fold::Stereo);
+            break;
+        }
+    }
+}
+
+void Mixers::ParseConfig(DspConfiguration& config, const Compressor& compressor) {
+    if (config.dirty_raw == 0)
+        return;
+
+    if (config.volume_0_dirty)
+        volume[0] = config.volume[0];
+    if (config.volume_1_dirty)
+        volume[1] = config.volume[1];
+    if (config.volume_2_dirty)
+        volume[2] = config.volume[2];
+
+    if (config.mixer1_enabled_dirty)
+        mixer_enabled[1] = config.mixer1_enabled != 0;
+    if (config.mixer2_enabled_dirty)
+        mixer_enabled[2] = config.mixer2_enabled != 0;
+
+    bool reselect = false;
+    if (config.output_format_dirty) {
+        output_format = config.output_format;
+        reselect = true;
+    }
+    if (config.mixer1_partial_surround_dirty) {
+        partial_surround[0] = config.mixer1_partial_surround != 0;
+        reselect = true;
+    }
+    if (config.mixer2_partial_surround_dirty) {
+        partial_surround[1] = config.mixer2_partial_surround != 0;
+        reselect = true;
+    }
+    if (reselect)
+        SelectDownmix();
+
+    if (config.limiter_enabled_dirty)
+        limiter.Configure(config, compressor);
+
+    if (config.delay_effect_0_dirty) {
+        delay_effect[0].Configure(config.delay_effect[0]);
+        config.delay_effect[0].dirty_raw = 0;
+    }
+    if (config.delay_effect_1_dirty) {
+        delay_effect[1].Configure(config.delay_effect[1]);
+        config.delay_effect[1].dirty_raw = 0;
+    }
+
+    config.dirty_raw = 0;
+}
+
+void Mixers::Tick(std::array<QuadFrame32, 3>& intermediate_mixes, FinalMixSamples& final_samples) {
+    {
+        PROFILE_SCOPE(Effects);
+        for (size_t i = 0; i < delay_effect.size(); i++) {
+            if (delay_effect[i].IsEnabled())
+                delay_effect[i].Process(intermediate_mixes[i + 1]);
+        }
+    }
+
+    PROFILE_SCOPE(FinalMix);
+    alignas(16) StereoFrame32 accumulator{};
+    for (size_t mixer = 0; mixer < intermediate_mixes.size(); mixer++) {
+        if (mixer_enabled[mixer] && volume[mixer] != 0.0f)
+            downmix_table[downmix[mixer]](intermediate_mixes[mixer], volume[mixer], accumulator);
+    }
+
+    limiter.Process(accumulator);
+
+    s16* const output = final_samples.pcm16;
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i += 2 * SIMD::lanes) {
+        const SIMD::S16x8 left = SIMD::PackSaturate(SIMD::Load(&accumulator[0][i]), SIMD::Load(&accumulator[0][i + SIMD::lanes]));
+        const SIMD::S16x8 right = SIMD::PackSaturate(SIMD::Load(&accumulator[1][i]), SIMD::Load(&accumulator[1][i + SIMD::lanes]));
+        SIMD::Store(&output[2 * i], SIMD::InterleaveLow(left, right));
+        SIMD::Store(&output[2 * i + 2 * SIMD::lanes], SIMD::InterleaveHigh(left, right));
+    }
+}
+
+} // namespace HLE
+} // namespace DSP
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+
+#if defined(_3DS)
+#include <3ds.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "profiler.h"
+
+namespace DSP {
+namespace HLE {
+namespace Profiler {
+
+namespace {
+
+constexpr std::array<const char*, static_cast<size_t>(Stage::Count)> stage_names{{
+    "Frame", "Source", "Queue", "Decode", "Interpolate", "Filter", "Mix", "Effects", "FinalMix",
+}};
+
+#if defined(DSP_PROFILE)
+
+/// Events of one thread. Only the owning thread writes; `written` publishes its events.
+struct Ring {
+    std::array<Event, ring_capacity> events;
+    std::atomic<u64> written{0};
+    u32 frame = 0;
+    u8 source = no_source;
+};
+
+std::array<Ring, max_threads> rings;
+std::atomic<size_t> rings_claimed{0};
+thread_local Ring* thread_ring = nullptr;
+thread_local bool thread_dropped = false;
+
+/// Counter and clock readings at the first recorded event, to calibrate the counter against.
+std::atomic<bool> calibrated{false};
+u64 origin_ticks;
+std::chrono::steady_clock::time_point origin_time;
+
+/// The calling thread's ring, claimed on first use. nullptr once every ring is taken.
+Ring* CurrentRing() {
+    if (thread_ring || thread_dropped)
+        return thread_ring;
+
+    const size_t index = rings_claimed.fetch_add(1, std::memory_order_relaxed);
+    if (index >= max_threads) {
+        thread_dropped = true;
+        return nullptr;
+    }
+    if (index == 0) {
+        origin_time = std::chrono::steady_clock::now();
+        origin_ticks = Now();
+        calibrated.store(true, std::memory_order_release);
+    }
+    thread_ring = &rings[index];
+    return thread_ring;
+}
+
+size_t ThreadCount() {
+    return std::min(rings_claimed.load(std::memory_order_acquire), max_threads);
+}
+
+#endif
+
+} // anonymous namespace
+
+const char* StageName(Stage stage) {
+    const size_t index = static_cast<size_t>(stage);
+    return index < stage_names.size() ? stage_names[index] : "Unknown";
+}
+
+u64 Now() {
+#if defined(_3DS)
+    return svcGetSystemTick();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    u64 ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<u64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+double TicksPerSecond() {
+#if defined(_3DS)
+    return SYSCLOCK_ARM11;
+#elif defined(__aarch64__)
+    u64 frequency;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(frequency));
+    return static_cast<double>(frequency);
+#elif defined(__x86_64__) || defined(__i386__)
+#if defined(DSP_PROFILE)
+    if (calibrated.load(std::memory_order_acquire)) {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - origin_time).count();
+        const u64 ticks = Now() - origin_ticks;
+        if (seconds > 0.0)
+            return static_cast<double>(ticks) / seconds;
+    }
+#endif
+    // Nothing recorded yet, so there is nothing to scale.
+    return 1e9;
+#else
+    return 1e9;
+#endif
+}
+
+#if defined(DSP_PROFILE)
+
+void SetFrame(u32 frame) {
+    if (Ring* const ring = CurrentRing())
+        ring->frame = frame;
+}
+
+Scope::Scope(Stage stage_, u8 source) : stage(stage_) {
+    Ring* const ring = CurrentRing();
+    frame = ring ? ring->frame : 0;
+    outer_source = ring ? ring->source : no_source;
+    if (ring && source != no_source)
+        ring->source = source;
+    begin = Now();
+}
+
+Scope::~Scope() {
+    const u64 end = Now();
+    Ring* const ring = thread_ring;
+    if (!ring)
+        return;
+
+    const u64 index = ring->written.load(std::memory_order_relaxed);
+    Event& event = ring->events[index % ring_capacity];
+    event.begin = begin;
+    event.duration = static_cast<u32>(std::min<u64>(end - begin, 0xFFFFFFFF));
+    event.frame = frame;
+    event.stage = stage;
+    event.source = ring->source;
+    ring->source = outer_source;
+    ring->written.store(index + 1, std::memory_order_release);
+}
+
+void ForEachEvent(const std::function<void(size_t thread, const Event& event)>& visit) {
+    for (size_t thread = 0; thread < ThreadCount(); thread++) {
+        const Ring& ring = rings[thread];
+        const u64 written = ring.written.load(std::memory_order_acquire);
+        const u64 first = written > ring_capacity ? written - ring_capacity : 0;
+        for (u64 i = first; i < written; i++)
+            visit(thread, ring.events[i % ring_capacity]);
+    }
+}
+
+void Clear() {
+    for (size_t thread = 0; thread < ThreadCount(); thread++)
+        rings[thread].written.store(0, std::memory_order_release);
+}
+
+#else
+
+void SetFrame(u32) {}
+
+Scope::Scope(Stage stage_, u8) : begin(0), frame(0), stage(stage_), outer_source(no_source) {}
+
+Scope::~Scope() {}
+
+void ForEachEvent(const std::function<void(size_t thread, const Event& event)>&) {}
+
+void Clear() {}
+
+#endif
+
+size_t WriteChromeTrace(std::FILE* file) {
+    // Timestamps are in microseconds from the earliest event, so the trace opens at zero.
+    u64 origin = ~u64{0};
+    ForEachEvent([&](size_t, const Event& event) { origin = std::min(origin, event.begin); });
+    const double microseconds_per_tick = 1e6 / TicksPerSecond();
+
+    size_t count = 0;
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+    ForEachEvent([&](size_t thread, const Event& event) {
+        std::fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"dsp\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u",
+                     count ? ",\n" : "", StageName(event.stage), thread,
+                     static_cast<double>(event.begin - origin) * microseconds_per_tick,
+                     static_cast<double>(event.duration) * microseconds_per_tick, static_cast<unsigned>(event.frame));
+        if (event.source != no_source)
+            std::fprintf(file, ",\"source\":%u", static_cast<unsigned>(event.source));
+        std::fputs("}}", file);
+        count++;
+    });
+    std::fputs("\n]}\n", file);
+    return count;
+}
+
+} // namespace Profiler
+} // namespace HLE
+} // namespace DSP
@@ -0,0 +1,525 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "profiler.h"
+#include "simd.h"
+#include "source.h"
+
+namespace DSP {
+namespace HLE {
+
+void Source::Reset() {
+    enabled = false;
+    playing = false;
+    skipped = false;
+    sync = 0;
+
+    format = Format::PCM16;
+    channels = 1;
+    adpcm_coeffs.fill(0);
+    adpcm_state = {};
+
+    rate = 1 << AudioInterp::position_bits;
+    fraction = 0;
+    interpolation_mode = InterpolationMode::Polyphase;
+    interpolation_related = 0;
+    for (auto& channel : history)
+        channel.fill(0);
+
+    queue.Reset();
+    filters = {};
+    mixer.Reset();
+    last_peak = 0x7FFF;
+    quiet_frames = 0;
+    queue_event = false;
+    SelectPipeline();
+}
+
+void Source::ParseConfig(SourceConfiguration::Configuration& config, const s16_le (&coeffs)[16]) {
+    if (config.dirty_raw == 0)
+        return;
+
+    if (config.reset_flag)
+        Reset();
+
+    if (config.partial_reset_flag)
+        queue.ClearPending();
+
+    if (config.enable_dirty)
+        enabled = config.enable != 0;
+
+    if (config.sync_dirty)
+        sync = config.sync;
+
+    if (config.rate_multiplier_dirty)
+        rate = AudioInterp::RateToFixed(config.rate_multiplier);
+
+    if (config.adpcm_coefficients_dirty)
+        std::copy(std::begin(coeffs), std::end(coeffs), adpcm_coeffs.begin());
+
+    if (config.gain_0_dirty || config.gain_1_dirty || config.gain_2_dirty)
+        mixer.ParseConfig(config, playing);
+
+    if (config.filters_enabled_dirty)
+        filters.Enable(config.simple_filter_enabled.ToBool(), config.biquad_filter_enabled.ToBool());
+    if (config.simple_filter_dirty)
+        filters.Configure(config.simple_filter);
+    if (config.biquad_filter_dirty)
+        filters.Configure(config.biquad_filter);
+
+    if (config.interpolation_dirty) {
+        interpolation_mode = config.interpolation_mode;
+        interpolation_related = config.interpolation_related;
+    }
+
+    if (config.format_dirty || config.embedded_buffer_dirty)
+        format = config.format;
+
+    if (config.mono_or_stereo_dirty || config.embedded_buffer_dirty) {
+        // The field is two bits wide. AudioTest-NumberOfChannels also probes 0 and 3; they are
+        // decoded by bit 1 here, so 0 plays as mono and 3 as stereo.
+        channels = static_cast<u16>(config.mono_or_stereo.Value()) & 2 ? 2 : 1;
+    }
+
+    if (config.embedded_buffer_dirty) {
+        // play_position applies to the first playthrough of the embedded buffer only, and is 0
+        // unless flagged dirty.
+        u32 play_position = 0;
+        if (config.play_position_dirty)
+            play_position = config.play_position;
+
+        BufferQueue::Buffer buffer;
+        buffer.physical_address = config.physical_address;
+        buffer.length = config.length;
+        buffer.play_position = play_position;
+        buffer.buffer_id = config.buffer_id;
+        buffer.adpcm_yn[0] = static_cast<s16>(config.adpcm_yn[0]);
+        buffer.adpcm_yn[1] = static_cast<s16>(config.adpcm_yn[1]);
+        buffer.adpcm_dirty = config.adpcm_dirty.ToBool();
+        buffer.is_looping = config.is_looping.ToBool();
+        buffer.from_queue = false;
+        queue.Push(buffer);
+        queue_event = true;
+
+        if (config.fade_in)
+            mixer.StartFadeIn();
+    }
+
+    if (config.buffer_queue_dirty) {
+        for (size_t i = 0; i < 4; i++) {
+            if (!(config.buffers_dirty & (1 << i)))
+                continue;
+
+            const auto& b = config.buffers[i];
+            BufferQueue::Buffer buffer;
+            buffer.physical_address = b.physical_address;
+            buffer.length = b.length;
+            buffer.buffer_id = b.buffer_id;
+            buffer.adpcm_yn[0] = static_cast<s16>(b.adpcm_yn[0]);
+            buffer.adpcm_yn[1] = static_cast<s16>(b.adpcm_yn[1]);
+            buffer.adpcm_dirty = b.adpcm_dirty != 0;
+            buffer.is_looping = b.is_looping != 0;
+            buffer.from_queue = true;
+            queue.Push(buffer);
+            queue_event = true;
+        }
+        config.buffers_dirty = 0;
+    }
+
+    if (config.format_dirty || config.mono_or_stereo_dirty || config.embedded_buffer_dirty || config.interpolation_dirty || config.filters_enabled_dirty)
+        SelectPipeline();
+
+    config.dirty_raw = 0;
+}
+
+template <Source::Format format, unsigned channels>
+void Source::DecodeSpan(const MemoryTranslator& memory, const BufferQueue::Span& span, AudioInterp::StagingBuffer& staging, u32 offset) {
+    s16* const left = &staging[0][AudioInterp::history_size + offset];
+    s16* const right = &staging[1][AudioInterp::history_size + offset];
+
+    const BufferQueue::Buffer& buffer = *span.buffer;
+    if constexpr (format == Format::ADPCM) {
+        if (span.starts_buffer && buffer.adpcm_dirty) {
+            adpcm_state.yn1 = buffer.adpcm_yn[0];
+            adpcm_state.yn2 = buffer.adpcm_yn[1];
+        }
+    }
+
+    const u8* const data = memory ? memory(buffer.physical_address, Codec::BytesForSamples(format, channels, buffer.length)) : nullptr;
+    if (!data) {
+        std::fill_n(left, span.count, 0);
+        if constexpr (channels == 2)
+            std::fill_n(right, span.count, 0);
+        return;
+    }
+
+    if constexpr (format == Format::PCM8)
+        Codec::DecodePCM8(data, channels, span.offset, span.count, left, right);
+    else if constexpr (format == Format::PCM16)
+        Codec::DecodePCM16(data, channels, span.offset, span.count, left, right);
+    else
+        Codec::DecodeADPCM(data, span.offset, span.count, adpcm_coeffs, adpcm_state, left);
+}
+
+template <Source::Format format, unsigned channels>
+u32 Source::FetchInput(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging) {
+    for (size_t ch = 0; ch < channels; ch++)
+        std::copy(history[ch].begin(), history[ch].end(), staging[ch].begin());
+
+    // Pull this frame's input, one span per buffer crossed. Past the end of the queue the input
+    // is silence.
+    const u32 needed = AudioInterp::InputSamplesNeeded(fraction, rate);
+    u32 written = 0;
+    queue.Consume(needed, [&](const BufferQueue::Span& span) {
+        queue_event |= span.starts_buffer;
+        DecodeSpan<format, channels>(memory, span, staging, written);
+        written += span.count;
+    });
+
+    for (size_t ch = 0; ch < channels; ch++) {
+        s16* const input = staging[ch].data() + AudioInterp::history_size;
+        std::fill(input + written, input + needed, 0);
+    }
+    return needed;
+}
+
+namespace {
+
+/// Decodes samples [n, n + count) of a PCM buffer. The runs FetchTouched decodes are a few samples
+/// long, too short for the vector loops of Codec.
+template <SourceConfiguration::Configuration::Format format, unsigned channels>
+FORCE_INLINE void DecodeRun(const u8* data, u32 n, u32 count, s16* left, s16* right) {
+    for (u32 k = 0; k < count; k++, n++) {
+        if constexpr (format == SourceConfiguration::Configuration::Format::PCM8) {
+            left[k] = static_cast<s16>(static_cast<s8>(data[n * channels]) * 256);
+            if constexpr (channels == 2)
+                right[k] = static_cast<s16>(static_cast<s8>(data[n * 2 + 1]) * 256);
+        } else {
+            std::memcpy(&left[k], data + n * channels * 2, 2);
+            if constexpr (channels == 2)
+                std::memcpy(&right[k], data + n * 4 + 2, 2);
+        }
+    }
+}
+
+} // anonymous namespace
+
+template <Source::Format format, unsigned channels, Source::InterpolationMode mode>
+u32 Source::FetchTouched(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging) {
+    for (size_t ch = 0; ch < channels; ch++)
+        std::copy(history[ch].begin(), history[ch].end(), staging[ch].begin());
+
+    static constexpr AudioInterp::KernelWindow window = mode == InterpolationMode::None     ? AudioInterp::none_window
+                                                 : mode == InterpolationMode::Linear ? AudioInterp::linear_window
+                                                                                     : AudioInterp::polyphase_window;
+    constexpr u32 history = static_cast<u32>(AudioInterp::history_size);
+    constexpr size_t outputs = AudioCore::samples_per_frame;
+    const u32 needed = AudioInterp::InputSamplesNeeded(fraction, rate);
+
+    // Window i < outputs is the run output i reads; window `outputs` is the next frame's history.
+    // Windows are visited in order and cut at span boundaries.
+    struct Cursor {
+        size_t i;
+        u32 position;
+        u32 start;
+        u32 end;
+    };
+    const auto advance = [this, needed](Cursor& c) {
+        c.i++;
+        c.position += rate;
+        c.start = c.i < outputs ? (c.position >> AudioInterp::position_bits) + window.first : needed;
+        c.end = c.i < outputs ? c.start + window.taps : needed + history;
+    };
+    Cursor cursor{0, fraction, (fraction >> AudioInterp::position_bits) + window.first,
+                  (fraction >> AudioInterp::position_bits) + window.first + window.taps};
+
+    u32 written = 0;
+    queue.Consume(needed, [&](const BufferQueue::Span& span) {
+        queue_event |= span.starts_buffer;
+        const u32 base = history + written;
+        const u32 end = base + span.count;
+        written += span.count;
+
+        const BufferQueue::Buffer& buffer = *span.buffer;
+        const u8* const data = memory ? memory(buffer.physical_address, Codec::BytesForSamples(format, channels, buffer.length)) : nullptr;
+        Cursor c = cursor;
+        if (data) {
+            // Windows wholly inside the span, the common case, have a fixed length.
+            for (; c.i < outputs && c.start >= base && c.end <= end; advance(c)) {
+                DecodeRun<format, channels>(data, span.offset + c.start - base, window.taps, &staging[0][c.start],
+                                            &staging[1][c.start]);
+            }
+        }
+        for (; c.i <= outputs; advance(c)) {
+            const u32 from = std::max(c.start, base);
+            const u32 to = std::min(c.end, end);
+            if (from < to) {
+                s16* const left = &staging[0][from];
+                s16* const right = &staging[1][from];
+                if (data) {
+                    DecodeRun<format, channels>(data, span.offset + from - base, to - from, left, right);
+                } else {
+                    std::fill_n(left, to - from, 0);
+                    if constexpr (channels == 2)
+                        std::fill_n(right, to - from, 0);
+                }
+            }
+            // A window running past this span continues in the next one.
+            if (c.end > end)
+                break;
+        }
+        cursor = c;
+    });
+
+    // Past the end of the queue the input is silence.
+    for (Cursor c = cursor; c.i <= outputs; advance(c)) {
+        const u32 from = std::max(c.start, history + written);
+        for (size_t ch = 0; ch < channels; ch++)
+            std::fill(staging[ch].begin() + from, staging[ch].begin() + std::max(from, c.end), 0);
+    }
+    return needed;
+}
+
+template <Source::Format format, unsigned channels>
+void Source::FetchLookahead(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging, u32 needed) {
+    BufferQueue ahead = queue;
+    const Codec::AdpcmState adpcm = adpcm_state;
+    const u32 delivered = ahead.Consume(AudioInterp::lookahead_size, [&](const BufferQueue::Span& span) {
+        DecodeSpan<format, channels>(memory, span, staging, needed);
+    });
+    adpcm_state = adpcm;
+
+    if (delivered == 0) {
+        for (size_t ch = 0; ch < channels; ch++)
+            staging[ch][AudioInterp::history_size + needed] = 0;
+    }
+}
+
+void Source::AdvancePosition(const AudioInterp::StagingBuffer& staging, u32 consumed, unsigned channels) {
+    for (size_t ch = 0; ch < channels; ch++)
+        std::copy_n(staging[ch].begin() + consumed, AudioInterp::history_size, history[ch].begin());
+
+    fraction = (fraction + rate * static_cast<u32>(AudioCore::samples_per_frame)) & ((1 << AudioInterp::position_bits) - 1);
+}
+
+namespace {
+
+/// Converts a preview frame channel to PCM16, truncating like the fixed-point kernels.
+void ToPCM16(const float* in, s16* out) {
+    const SIMD::F32x4 max = SIMD::Splat(32767.0f);
+    const SIMD::F32x4 min = SIMD::Splat(-32768.0f);
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i += 2 * SIMD::lanes) {
+        const SIMD::S32x4 lo = SIMD::Truncate(SIMD::Min(SIMD::Max(SIMD::Load(in + i), min), max));
+        const SIMD::S32x4 hi = SIMD::Truncate(SIMD::Min(SIMD::Max(SIMD::Load(in + i + SIMD::lanes), min), max));
+        SIMD::Store(out + i, SIMD::PackSaturate(lo, hi));
+    }
+}
+
+} // anonymous namespace
+
+template <bool preview, Source::Format format, unsigned channels, Source::InterpolationMode mode, bool simple_on, bool biquad_on>
+void Source::RunPipeline(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging, StereoFrame16& frame) {
+    u32 consumed;
+    {
+        PROFILE_SCOPE(Decode);
+        if constexpr (format != Format::ADPCM && !(format == Format::PCM16 && channels == 1)) {
+            consumed = rate >= sparse_fetch_rate ? FetchTouched<format, channels, mode>(memory, staging)
+                                                 : FetchInput<format, channels>(memory, staging);
+        } else {
+            consumed = FetchInput<format, channels>(memory, staging);
+        }
+        if constexpr (mode == InterpolationMode::Polyphase)
+            FetchLookahead<format, channels>(memory, staging, consumed);
+    }
+
+    if constexpr (preview) {
+        alignas(16) StereoFrameFloat samples;
+        {
+            PROFILE_SCOPE(Interpolate);
+            for (size_t ch = 0; ch < channels; ch++) {
+                const s16* const input = staging[ch].data();
+                if constexpr (mode == InterpolationMode::None)
+                    AudioInterp::NonePreview(input, fraction, rate, samples[ch].data());
+                else if constexpr (mode == InterpolationMode::Linear)
+                    AudioInterp::LinearPreview(input, fraction, rate, samples[ch].data());
+                else
+                    AudioInterp::PolyphasePreview(input, fraction, rate, interpolation_related, samples[ch].data());
+            }
+        }
+
+        PROFILE_SCOPE(Filter);
+        filters.ProcessPreview<simple_on, biquad_on>(samples, channels);
+        for (size_t ch = 0; ch < channels; ch++)
+            ToPCM16(samples[ch].data(), frame[ch].data());
+    } else {
+        {
+            PROFILE_SCOPE(Interpolate);
+            for (size_t ch = 0; ch < channels; ch++) {
+                const s16* const input = staging[ch].data();
+                if constexpr (mode == InterpolationMode::None)
+                    AudioInterp::None(input, fraction, rate, frame[ch].data());
+                else if constexpr (mode == InterpolationMode::Linear)
+                    AudioInterp::Linear(input, fraction, rate, frame[ch].data());
+                else
+                    AudioInterp::Polyphase(input, fraction, rate, interpolation_related, frame[ch].data());
+            }
+        }
+
+        PROFILE_SCOPE(Filter);
+        filters.Process<simple_on, biquad_on>(frame, channels);
+    }
+
+    AdvancePosition(staging, consumed, channels);
+
+    // Mono sources are filtered once and then duplicated.
+    if constexpr (channels == 1)
+        frame[1] = frame[0];
+}
+
+template <Source::Format format, unsigned channels>
+void Source::SkipPipeline(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging, StereoFrame16&) {
+    // The ADPCM predictor depends on every sample before it, so ADPCM input is still decoded.
+    if constexpr (format == Format::ADPCM) {
+        AdvancePosition(staging, FetchInput<format, channels>(memory, staging), channels);
+        return;
+    }
+
+    for (size_t ch = 0; ch < channels; ch++)
+        std::copy(history[ch].begin(), history[ch].end(), staging[ch].begin());
+
+    // PCM samples decode independently: only those that become the next frame's history are
+    // decoded, the rest of each span is stepped over.
+    const u32 needed = AudioInterp::InputSamplesNeeded(fraction, rate);
+    const u32 keep_from = needed > AudioInterp::history_size ? needed - static_cast<u32>(AudioInterp::history_size) : 0;
+    u32 written = 0;
+    queue.Consume(needed, [&](const BufferQueue::Span& span) {
+        queue_event |= span.starts_buffer;
+        if (written + span.count > keep_from) {
+            const u32 step = keep_from > written ? keep_from - written : 0;
+            BufferQueue::Span tail = span;
+            tail.offset += step;
+            tail.count -= step;
+            DecodeSpan<format, channels>(memory, tail, staging, written + step);
+        }
+        written += span.count;
+    });
+
+    for (size_t ch = 0; ch < channels; ch++) {
+        s16* const input = staging[ch].data() + AudioInterp::history_size;
+        std::fill(input + std::max(written, keep_from), input + needed, 0);
+    }
+    AdvancePosition(staging, needed, channels);
+}
+
+u16 Source::FramePeak(const StereoFrame16& frame) const {
+    s32 peak = 0;
+    for (size_t ch = 0; ch < channels; ch++) {
+        for (s16 sample : frame[ch])
+            peak = std::max(peak, std::abs(static_cast<s32>(sample)));
+    }
+    return static_cast<u16>(std::min(peak, 0x7FFF));
+}
+
+template <size_t... indices>
+constexpr std::array<Source::PipelineFn, Source::num_pipelines> Source::MakePipelineTable(std::index_sequence<indices...>) {
+    // index = (((preview * 3 + format) * 2 + stereo) * 3 + interpolation_mode) * 4 + filters_enabled,
+    // so the fields index the table by their raw values. ADPCM is always decoded as mono.
+    constexpr auto preview_of = [](size_t index) { return index >= 72; };
+    constexpr auto format_of = [](size_t index) { return static_cast<Format>(index % 72 / 24); };
+    constexpr auto channels_of = [](size_t index) -> unsigned { return index % 72 / 24 == 2 ? 1 : 1 + index / 12 % 2; };
+    constexpr auto mode_of = [](size_t index) { return static_cast<InterpolationMode>(index / 4 % 3); };
+
+    return {{&Source::RunPipeline<preview_of(indices), format_of(indices), channels_of(indices), mode_of(indices), (indices & 1) != 0, (indices & 2) != 0>...}};
+}
+
+const std::array<Source::PipelineFn, Source::num_pipelines> Source::pipeline_table =
+    MakePipelineTable(std::make_index_sequence<num_pipelines>{});
+
+const std::array<Source::PipelineFn, 6> Source::skip_table{{
+    &Source::SkipPipeline<Format::PCM8, 1>,  &Source::SkipPipeline<Format::PCM8, 2>,
+    &Source::SkipPipeline<Format::PCM16, 1>, &Source::SkipPipeline<Format::PCM16, 2>,
+    &Source::SkipPipeline<Format::ADPCM, 1>, &Source::SkipPipeline<Format::ADPCM, 1>,
+}};
+
+void Source::SelectPipeline() {
+    const size_t precision_index = precision == Precision::Preview ? 1 : 0;
+    // The format field is two bits wide; the undefined value 3 is decoded as PCM16.
+    size_t format_index = static_cast<size_t>(format);
+    if (format_index > 2)
+        format_index = static_cast<size_t>(Format::PCM16);
+    // Unknown interpolation modes use polyphase.
+    size_t mode_index = static_cast<size_t>(interpolation_mode);
+    if (mode_index > 2)
+        mode_index = static_cast<size_t>(InterpolationMode::Polyphase);
+    const size_t filter_index = (filters.IsSimpleEnabled() ? 1 : 0) | (filters.IsBiquadEnabled() ? 2 : 0);
+
+    pipeline = static_cast<u16>((((precision_index * 3 + format_index) * 2 + (channels - 1)) * 3 + mode_index) * 4 + filter_index);
+    skip_pipeline = static_cast<u8>(format_index * 2 + (channels - 1));
+}
+
+void Source::SetPrecision(Precision precision_) {
+    precision = precision_;
+    SelectPipeline();
+}
+
+bool Source::GenerateFrame(const MemoryTranslator& memory, AudioInterp::StagingBuffer& staging, StereoFrame16& frame,
+                           u16 silence_threshold, bool skip_muted) {
+    playing = false;
+    skipped = false;
+    if (!enabled)
+        return false;
+
+    {
+        PROFILE_SCOPE(Queue);
+        if (!queue.Prime()) {
+            enabled = false;
+            return false;
+        }
+        queue.BeginFrame();
+    }
+
+    // A skipped source still counts as playing, so gain changes made to it ramp as usual.
+    playing = true;
+
+    // The filters' state depends on every sample they are fed, so a muted source with a filter on
+    // is rendered: skipping it would change its output once it is heard again.
+    const bool muted = skip_muted && mixer.IsSilent() && !filters.IsSimpleEnabled() && !filters.IsBiquadEnabled();
+    const bool quiet = silence_threshold != 0 && !queue_event && last_peak < silence_threshold &&
+                       quiet_frames < silence_recheck_frames;
+    if (muted || quiet) {
+        {
+            PROFILE_SCOPE(Decode);
+            (this->*skip_table[skip_pipeline])(memory, staging, frame);
+        }
+        skipped = true;
+        // Nothing is known about the level of a muted source, so it is measured again once heard.
+        if (muted)
+            last_peak = 0x7FFF;
+        else
+            quiet_frames++;
+        return true;
+    }
+
+    queue_event = false;
+    quiet_frames = 0;
+    (this->*pipeline_table[pipeline])(memory, staging, frame);
+    last_peak = silence_threshold != 0 ? FramePeak(frame) : 0x7FFF;
+    return false;
+}
+
+void Source::MixInto(const StereoFrame16& frame, std::array<QuadFrame32, 3>& mixes) {
+    if (playing && !skipped)
+        mixer.Mix(frame, mixes);
+}
+
+void Source::WriteStatus(SourceStatus::Status& status) {
+    status.is_enabled = enabled;
+    status.current_buffer_id_dirty = queue.TakeBufferUpdate() ? 1 : 0;
+    status.sync = sync;
+    status.buffer_position = queue.StatusPosition();
+    status.current_buffer_id = queue.CurrentBufferId();
+}
+
+} // namespace HLE
+} // namespace DSP
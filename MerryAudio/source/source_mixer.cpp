@@ -0,0 +1,122 @@
+#include "simd.h"
+#include "source_mixer.h"
+
+namespace DSP {
+namespace HLE {
+
+namespace {
+
+/// Position of each sample within the frame, (i + 1) / samples_per_frame. A ramp reaches its
+/// target on the last sample of the frame.
+alignas(16) const std::array<float, AudioCore::samples_per_frame> ramp_position = [] {
+    std::array<float, AudioCore::samples_per_frame> ret{};
+    for (size_t i = 0; i < ret.size(); i++)
+        ret[i] = static_cast<float>(i + 1) / AudioCore::samples_per_frame;
+    return ret;
+}();
+
+/**
+ * Accumulates one channel of source output into one channel of a mixer. The gain envelope is
+ * computed alongside the samples, one multiply-add per vector for each envelope that is active.
+ */
+template <bool ramp, bool fade>
+void MixChannel(const s16* input, s32* output, float start, float delta) {
+    const SIMD::F32x4 start_gain = SIMD::Splat(start);
+    const SIMD::F32x4 delta_gain = SIMD::Splat(delta);
+
+    for (size_t i = 0; i < AudioCore::samples_per_frame; i += SIMD::lanes) {
+        SIMD::F32x4 gain = start_gain;
+        if constexpr (ramp || fade) {
+            const SIMD::F32x4 position = SIMD::Load(&ramp_position[i]);
+            if constexpr (ramp)
+                gain = start_gain + delta_gain * position;
+            if constexpr (fade)
+                gain = gain * position;
+        }
+
+        const SIMD::F32x4 sample = SIMD::ToFloat(SIMD::LoadWiden(&input[i]));
+        SIMD::Store(&output[i], SIMD::Load(&output[i]) + SIMD::Truncate(gain * sample));
+    }
+}
+
+} // anonymous namespace
+
+void SourceMixer::Reset() {
+    for (auto& row : gain)
+        row.fill(0.0f);
+    target = gain;
+    ramping.fill(false);
+    fade_in = false;
+}
+
+void SourceMixer::ParseConfig(const SourceConfiguration::Configuration& config, bool playing) {
+    const std::array<bool, 3> dirty{{config.gain_0_dirty.ToBool(), config.gain_1_dirty.ToBool(), config.gain_2_dirty.ToBool()}};
+
+    for (size_t mixer = 0; mixer < dirty.size(); mixer++) {
+        if (!dirty[mixer])
+            continue;
+
+        for (size_t channel = 0; channel < target[mixer].size(); channel++)
+            target[mixer][channel] = config.gain[mixer][channel];
+
+        if (playing) {
+            ramping[mixer] = true;
+        } else {
+            gain[mixer] = target[mixer];
+            ramping[mixer] = false;
+        }
+    }
+}
+
+void SourceMixer::StartFadeIn() {
+    fade_in = true;
+}
+
+bool SourceMixer::IsSilent() const {
+    if (fade_in)
+        return false;
+
+    for (size_t mixer = 0; mixer < gain.size(); mixer++) {
+        for (size_t channel = 0; channel < 4; channel++) {
+            if (gain[mixer][channel] != 0.0f || target[mixer][channel] != 0.0f)
+                return false;
+        }
+    }
+    return true;
+}
+
+void SourceMixer::Mix(const StereoFrame16& frame, std::array<QuadFrame32, 3>& mixes) {
+    for (size_t mixer = 0; mixer < mixes.size(); mixer++) {
+        for (size_t channel = 0; channel < 4; channel++) {
+            const float start = gain[mixer][channel];
+            const float delta = target[mixer][channel] - start;
+            const bool ramp = ramping[mixer] && delta != 0.0f;
+
+            if (!ramp && start == 0.0f)
+                continue;
+
+            // Left source channel feeds the left mixer channels (0 and 2), right feeds 1 and 3.
+            const s16* input = frame[channel % 2].data();
+            s32* output = mixes[mixer][channel].data();
+
+            if (ramp && fade_in)
+                MixChannel<true, true>(input, output, start, delta);
+            else if (ramp)
+                MixChannel<true, false>(input, output, start, delta);
+            else if (fade_in)
+                MixChannel<false, true>(input, output, start, delta);
+            else
+                MixChannel<false, false>(input, output, start, delta);
+        }
+
+        if (ramping[mixer]) {
+            gain[mixer] = target[mixer];
+            ramping[mixer] = false;
+        }
+    }
+
+    fade_in = false;
+}
+
+} // namespace HLE
+} // namespace DSP
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#if defined(_3DS)
+#include <3ds.h>
+#endif
+
+#include "filter_design.h"
+#include "stress_scene.h"
+
+namespace DSP {
+namespace HLE {
+namespace StressScene {
+
+namespace {
+
+using Configuration = SourceConfiguration::Configuration;
+using Format = Configuration::Format;
+using MonoOrStereo = Configuration::MonoOrStereo;
+using InterpolationMode = Configuration::InterpolationMode;
+
+/// Physical address Measure places the sample data at, the start of FCRAM.
+constexpr PAddr measure_address = 0x20000000;
+
+Format SourceFormat(size_t index) {
+    return static_cast<Format>(index % 3);
+}
+
+bool IsStereo(size_t index) {
+    return (index / 3) % 2 == 1 && SourceFormat(index) != Format::ADPCM;
+}
+
+InterpolationMode SourceInterpolation(size_t index) {
+    return static_cast<InterpolationMode>((index / 6) % 3);
+}
+
+/// A different pair of partials for every source and channel, in [-1, 1].
+double Signal(size_t index, size_t channel, u32 sample) {
+    const double t = static_cast<double>(sample);
+    const double base = 0.011 + 0.0023 * static_cast<double>(index) + 0.0007 * static_cast<double>(channel);
+    return std::sin(t * base) * 0.7 + std::sin(t * base * 7.3) * 0.2;
+}
+
+void FillAdpcm(size_t index, u8* data) {
+    // Valid headers with a spread of predictors and scales; the nibbles follow the signal's slope.
+    constexpr u32 samples_per_block = 14;
+    for (u32 block = 0; block < buffer_samples / samples_per_block; block++) {
+        u8* const out = data + block * 8;
+        out[0] = static_cast<u8>(((block + index) % 8) << 4 | (2 + block % 5));
+        for (u32 i = 0; i < samples_per_block; i++) {
+            const u32 sample = block * samples_per_block + i;
+            const double slope = Signal(index, 0, sample + 1) - Signal(index, 0, sample);
+            const u8 nibble = static_cast<u8>(static_cast<s32>(std::lround(slope * 40.0)) & 0xF);
+            u8& byte = out[1 + i / 2];
+            byte = i % 2 == 0 ? static_cast<u8>(nibble << 4) : static_cast<u8>(byte | nibble);
+        }
+    }
+}
+
+u64 Ticks() {
+#if defined(_3DS)
+    return svcGetSystemTick();
+#else
+    return static_cast<u64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+double MicrosecondsPerTick() {
+#if defined(_3DS)
+    return 1e6 / SYSCLOCK_ARM11;
+#else
+    return 1e-3;
+#endif
+}
+
+} // anonymous namespace
+
+void FillSampleData(u8* data) {
+    for (size_t index = 0; index < AudioCore::num_sources; index++) {
+        u8* const buffer = data + index * buffer_stride;
+        const size_t channels = IsStereo(index) ? 2 : 1;
+        switch (SourceFormat(index)) {
+        case Format::PCM8:
+            for (u32 sample = 0; sample < buffer_samples; sample++) {
+                for (size_t ch = 0; ch < channels; ch++)
+                    buffer[sample * channels + ch] = static_cast<u8>(static_cast<s8>(Signal(index, ch, sample) * 127.0));
+            }
+            break;
+        case Format::PCM16:
+            for (u32 sample = 0; sample < buffer_samples; sample++) {
+                for (size_t ch = 0; ch < channels; ch++) {
+                    const s16 value = static_cast<s16>(Signal(index, ch, sample) * 32767.0);
+                    std::memcpy(buffer + (sample * channels + ch) * 2, &value, 2);
+                }
+            }
+            break;
+        case Format::ADPCM:
+            FillAdpcm(index, buffer);
+            break;
+        }
+    }
+}
+
+void ConfigureSource(size_t index, Configuration& config, PAddr data_address) {
+    // 24 sources into each mix, with headroom for the filters' peaks.
+    for (size_t mix = 0; mix < 3; mix++) {
+        for (size_t ch = 0; ch < 4; ch++)
+            config.gain[mix][ch] = 0.03f;
+    }
+    config.gain_0_dirty.Assign(1);
+    config.gain_1_dirty.Assign(1);
+    config.gain_2_dirty.Assign(1);
+
+    config.rate_multiplier = 0.5f + 0.095f * static_cast<float>(index);
+    config.rate_multiplier_dirty.Assign(1);
+    config.interpolation_mode = SourceInterpolation(index);
+    config.interpolation_related = 0;
+    config.interpolation_dirty.Assign(1);
+
+    const double corner = 1500.0 + 350.0 * static_cast<double>(index);
+    config.simple_filter = FilterDesign::Quantize(FilterDesign::OnePoleLowPass(corner * 2.0));
+    config.simple_filter_dirty.Assign(1);
+    switch (index % 3) {
+    case 0:
+        config.biquad_filter = FilterDesign::Quantize(FilterDesign::LowPass(corner, 0.7071));
+        break;
+    case 1:
+        config.biquad_filter = FilterDesign::Quantize(FilterDesign::HighPass(corner / 8.0, 0.7071));
+        break;
+    default:
+        config.biquad_filter = FilterDesign::Quantize(FilterDesign::Peaking(corner, 1.0, 4.0));
+        break;
+    }
+    config.biquad_filter_dirty.Assign(1);
+    config.filters_enabled = 3;
+    config.filters_enabled_dirty.Assign(1);
+    config.adpcm_coefficients_dirty.Assign(1);
+
+    config.format.Assign(SourceFormat(index));
+    config.mono_or_stereo.Assign(IsStereo(index) ? MonoOrStereo::Stereo : MonoOrStereo::Mono);
+    config.physical_address = data_address + static_cast<u32>(index) * buffer_stride;
+    config.length = buffer_samples;
+    config.play_position = 0;
+    config.play_position_dirty.Assign(1);
+    config.buffer_id = 1;
+    config.is_looping.Assign(1);
+    config.adpcm_dirty.Assign(0);
+    config.embedded_buffer_dirty.Assign(1);
+    config.enable = 1;
+    config.enable_dirty.Assign(1);
+}
+
+void ConfigureAdpcm(AdpcmCoefficients& coefficients) {
+    for (size_t index = 0; index < AudioCore::num_sources; index++) {
+        for (size_t c = 0; c < 8; c++) {
+            coefficients.coeff[index][c * 2 + 0] = static_cast<s16>(1024 + 256 * c);
+            coefficients.coeff[index][c * 2 + 1] = static_cast<s16>(-512 - 64 * c);
+        }
+    }
+}
+
+void ConfigureMixers(DspConfiguration& config) {
+    for (size_t mix = 0; mix < 3; mix++)
+        config.volume[mix] = 1.0f;
+    config.volume_0_dirty.Assign(1);
+    config.volume_1_dirty.Assign(1);
+    config.volume_2_dirty.Assign(1);
+
+    for (size_t i = 0; i < 2; i++) {
+        DspConfiguration::DelayEffect& effect = config.delay_effect[i];
+        effect.enable = 1;
+        effect.enable_dirty.Assign(1);
+        effect.frame_count = static_cast<u16>(5 + i);
+        effect.g = 40;
+        effect.a = 90;
+        effect.b = 30;
+        effect.other_dirty.Assign(1);
+    }
+    config.delay_effect_0_dirty.Assign(1);
+    config.delay_effect_1_dirty.Assign(1);
+}
+
+void Configure(SharedMemory& region, PAddr data_address) {
+    for (size_t index = 0; index < AudioCore::num_sources; index++)
+        ConfigureSource(index, region.source_configurations.config[index], data_address);
+    ConfigureAdpcm(region.adpcm_coefficients);
+    ConfigureMixers(region.dsp_configuration);
+}
+
+namespace {
+
+/// The scene's sample data, and a region configured to play it from measure_address.
+struct Scene {
+    std::vector<u8> data;
+    std::unique_ptr<SharedMemory> region;
+
+    Scene() : data(data_size), region(std::make_unique<SharedMemory>()) {
+        FillSampleData(data.data());
+        std::memset(static_cast<void*>(region.get()), 0, sizeof(SharedMemory));
+        Configure(*region, measure_address);
+    }
+
+    MemoryTranslator Memory() const {
+        return [base = data.data(), size = data.size()](PAddr address, u32 bytes) -> const u8* {
+            if (address < measure_address || address - measure_address > size || bytes > size - (address - measure_address))
+                return nullptr;
+            return base + (address - measure_address);
+        };
+    }
+};
+
+} // anonymous namespace
+
+Measurement Measure(size_t frames, Precision precision) {
+    Scene scene;
+    SharedMemory* const region = scene.region.get();
+    // Far larger than the 3DS main thread's stack.
+    const auto engine = std::make_unique<Engine>(scene.Memory());
+    engine->SetPrecision(precision);
+
+    Measurement measurement;
+    measurement.frame_us.reserve(frames);
+    measurement.min_active_sources = AudioCore::num_sources;
+    const double microseconds_per_tick = MicrosecondsPerTick();
+    for (size_t frame = 0; frame < frames; frame++) {
+        region->frame_counter = static_cast<u16>(frame);
+        const u64 begin = Ticks();
+        engine->Tick(*region);
+        const u64 end = Ticks();
+        measurement.frame_us.push_back(static_cast<double>(end - begin) * microseconds_per_tick);
+
+        size_t active = 0;
+        for (const auto& status : region->source_statuses.status)
+            active += status.is_enabled ? 1 : 0;
+        measurement.min_active_sources = std::min(measurement.min_active_sources, active);
+    }
+    return measurement;
+}
+
+ErrorStats MeasurePreviewError(size_t frames) {
+    Scene scene;
+    const auto engine = std::make_unique<Engine>(scene.Memory());
+    engine->SetPrecision(Precision::Preview);
+    engine->EnableErrorMeter(true);
+    for (size_t frame = 0; frame < frames; frame++) {
+        scene.region->frame_counter = static_cast<u16>(frame);
+        engine->Tick(*scene.region);
+    }
+    return engine->GetErrorStats();
+}
+
+Summary Summarize(const Measurement& measurement) {
+    const std::vector<double>& times = measurement.frame_us;
+    if (times.empty())
+        return {0.0, 0.0, 0.0, 0.0, 0};
+
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double time : sorted)
+        sum += time;
+    const auto at = [&](double q) { return sorted[std::min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()))]; };
+    const size_t worst = static_cast<size_t>(std::max_element(times.begin(), times.end()) - times.begin());
+    return {sum / sorted.size(), at(0.5), at(0.99), sorted.back(), worst};
+}
+
+} // namespace StressScene
+} // namespace HLE
+} // namespace DSP